@@ -0,0 +1,2 @@
+#include "luaot_header.c"
+
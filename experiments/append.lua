@@ -0,0 +1,80 @@
+-- Arrays built by appending with 't[#t+1] = v' and 'table.insert', and
+-- used as a stack with 't[#t]' and 't[#t] = nil'. In 'spill', the tables
+-- already have a large hash part with free nodes, where the appended
+-- elements go. Prints the time of each pattern and how many of its '#t'
+-- had to search for a border (see debug.lenstats). See
+-- ../scripts/bench-len.
+
+local function append(N)
+    local sum = 0
+    for _ = 1, 10 do
+        local t = {}
+        for i = 1, N do
+            t[#t + 1] = i
+        end
+        sum = sum + #t
+    end
+    return sum
+end
+
+local function insert(N)
+    local sum = 0
+    for _ = 1, 10 do
+        local t = {}
+        for i = 1, N do
+            table.insert(t, i)
+        end
+        sum = sum + #t
+    end
+    return sum
+end
+
+local function stack(N)
+    local sum = 0
+    local t = {}
+    for i = 1, 10 * N do
+        if i % 3 == 0 then
+            sum = sum + t[#t]
+            t[#t] = nil
+        else
+            t[#t + 1] = i
+        end
+    end
+    return sum + #t
+end
+
+local function spill(N)
+    local sum = 0
+    local M = N // 10
+    for _ = 1, 10 do
+        local t = {}
+        for i = 1, M do t[-i] = i end  -- grow the hash part...
+        for i = 1, M do t[-i] = nil end  -- ...and leave it empty
+        for i = 1, M do
+            t[#t + 1] = i
+        end
+        sum = sum + #t
+    end
+    return sum
+end
+
+return function(N)
+    N = N or 1000000
+    for _, test in ipairs({{"append", append}, {"insert", insert},
+                           {"stack", stack}, {"spill", spill}}) do
+        collectgarbage()
+        debug.lenstats(true)
+        local start = os.clock()
+        local sum = test[2](N)
+        local time = os.clock() - start
+        local hits, searches = debug.lenstats()
+        if hits then
+            print(string.format("%-6s %d %.0f ms, %d of %d lengths searched",
+                                test[1], sum, time * 1000, searches,
+                                hits + searches))
+        else  -- built without LUAI_LENSTATS
+            print(string.format("%-6s %d %.0f ms, %d lengths searched",
+                                test[1], sum, time * 1000, searches))
+        end
+    end
+end
@@ -0,0 +1,28 @@
+-- A cache that grows to millions of keys, inserted in batches of 1000.
+-- Prints the total time and the time of the slowest batch, which includes
+-- the pauses to rehash the table. The keys are sparse integers, so that
+-- they all go to the hash part and creating them costs nothing. See
+-- ../scripts/bench-rehash.
+
+return function(N)
+    N = N or 4000000
+    local cache = {}
+    local clock = os.clock
+    local worst = 0
+    local start = clock()
+    for i = 1, N, 1000 do
+        local t0 = clock()
+        for j = i, i + 999 do
+            cache[j * 7919] = j
+        end
+        local dt = clock() - t0
+        if dt > worst then worst = dt end
+    end
+    local total = clock() - start
+    local sum = 0
+    for i = 1, N, 97 do
+        sum = sum + cache[i * 7919]
+    end
+    print(string.format("%d total %.0f ms, slowest batch %.2f ms",
+                        sum, total * 1000, worst * 1000))
+end
@@ -0,0 +1,45 @@
+-- Bulk operations on large arrays: shifting with table.move, filling
+-- with table.fill and copying a range with table.slice, compared with
+-- the same operations written as Lua loops. Prints the time of each
+-- version. See ../scripts/bench-bulk.
+
+local function loopmove(t, f, e, d)
+    for i = e - f, 0, -1 do t[d + i] = t[f + i] end
+end
+
+local function loopfill(t, v, i, j)
+    for k = i, j do t[k] = v end
+end
+
+local function loopslice(t, i, j)
+    local r = {}
+    for k = i, j do r[k - i + 1] = t[k] end
+    return r
+end
+
+local M = 100000
+
+local tests = {
+    {"move", function(t) table.move(t, 1, M - 1, 2) end,
+             function(t) loopmove(t, 1, M - 1, 2) end},
+    {"fill", function() table.fill({}, 0, 1, M) end,
+             function() loopfill({}, 0, 1, M) end},
+    {"slice", function(t) return table.slice(t, 2, M) end,
+              function(t) return loopslice(t, 2, M) end},
+}
+
+return function(N)
+    N = N or 200
+    local t = {}
+    for i = 1, M do t[i] = "s" .. i end
+    for _, test in ipairs(tests) do
+        for v = 2, 3 do
+            collectgarbage()
+            local start = os.clock()
+            for _ = 1, N do test[v](t) end
+            print(string.format("%-5s %-4s %.0f ms", test[1],
+                                v == 2 and "lib" or "loop",
+                                (os.clock() - start) * 1000))
+        end
+    end
+end
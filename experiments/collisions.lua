@@ -0,0 +1,48 @@
+-- Collisions in the hash part of tables with integer and float keys:
+-- sequential ids, ids with a stride of 1024, random ids, and float
+-- timestamps one millisecond apart. Prints, for each kind of key, the
+-- mean and maximum number of probes of a search for a key (see
+-- debug.gethashstats) and the time of a lookup in nanoseconds.
+
+local base = 1 << 24  -- keep the keys out of the array part
+
+local kinds = {
+    {"sequential", function(i) return base + i end},
+    {"strided", function(i) return base + i * 1024 end},
+    {"random", function() return math.random(1, 1 << 30) end},
+    {"timestamps", function(i) return 1.7e9 + i / 1000 end},
+}
+
+local function lookups(t, keys, reps)
+    local sum = 0
+    for _ = 1, reps do
+        for j = 1, #keys do
+            sum = sum + t[keys[j]]
+        end
+    end
+    return sum
+end
+
+return function(N)
+    N = N or 100000
+    local reps = math.max(1, 10000000 // N)
+    math.randomseed(42)
+    for _, kind in ipairs(kinds) do
+        local t, keys = {}, {}
+        for i = 1, N do
+            local k = kind[2](i)
+            t[k] = i
+            keys[i] = k
+        end
+        local probes = "-"
+        if debug.gethashstats then  -- not in older interpreters
+            local s = debug.gethashstats(t)
+            probes = string.format("%.2f (max %d)", s.meanprobes, s.maxprobes)
+        end
+        collectgarbage()
+        local start = os.clock()
+        lookups(t, keys, reps)
+        local ns = (os.clock() - start) * 1e9 / (reps * N)
+        print(string.format("%-10s probes %-14s %5.1f ns", kind[1], probes, ns))
+    end
+end
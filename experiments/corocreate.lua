@@ -0,0 +1,24 @@
+-- One coroutine per request, like a server that runs each request in a
+-- new coroutine: create it, resume it until it finishes, and drop it.
+-- See ../scripts/bench-coro.
+
+local function handler(req)
+    coroutine.yield(req.x)
+    coroutine.yield(req.y)
+    return req.x + req.y
+end
+
+return function(N)
+    N = N or 1000000
+    local req = { x = 1, y = 2 }
+    local sum = 0
+    for i = 1, N do
+        req.x = i
+        local co = coroutine.create(handler)
+        local _, a = coroutine.resume(co, req)
+        local _, b = coroutine.resume(co)
+        local _, c = coroutine.resume(co)
+        sum = sum + a + b + c
+    end
+    print(sum)
+end
@@ -0,0 +1,25 @@
+-- Same requests as corocreate.lua, but each finished coroutine is given
+-- the next request with coroutine.recycle instead of creating a new one.
+-- See ../scripts/bench-coro.
+
+local function handler(req)
+    coroutine.yield(req.x)
+    coroutine.yield(req.y)
+    return req.x + req.y
+end
+
+return function(N)
+    N = N or 1000000
+    local req = { x = 1, y = 2 }
+    local sum = 0
+    local co = coroutine.create(handler)
+    for i = 1, N do
+        req.x = i
+        local _, a = coroutine.resume(co, req)
+        local _, b = coroutine.resume(co)
+        local _, c = coroutine.resume(co)
+        sum = sum + a + b + c
+        assert(coroutine.recycle(co, handler))
+    end
+    print(sum)
+end
@@ -0,0 +1,48 @@
+-- Keys that are removed, collected as dead keys and inserted again, and
+-- then traversed with next. A traversal must see each key once, which
+-- failed with LUAI_SWISSTABLE when the new key went to another node than
+-- its dead copy. Raises an error on failure. ../scripts/bench-hash runs it
+-- with both hash parts.
+
+local function count(t)
+    local n, k = 0, nil
+    repeat
+        k = next(t, k)
+        if k ~= nil then
+            n = n + 1
+            assert(n <= 1000, "traversal does not end")
+        end
+    until k == nil
+    return n
+end
+
+return function(N)
+    N = N or 100
+    -- the original case: 6 string keys, one of them removed and set again
+    local t = {}
+    for i = 1, 6 do t["key" .. i] = i end
+    t.key3 = nil
+    collectgarbage()
+    t.key3 = 3
+    assert(count(t) == 6)
+
+    -- random removals and insertions, with collections in between
+    math.randomseed(42)
+    for _ = 1, N do
+        local u, live = {}, 0
+        local present = {}
+        for _ = 1, 200 do
+            local k = "k" .. math.random(50)
+            if math.random(3) == 1 then
+                if present[k] then live = live - 1 end
+                u[k], present[k] = nil, nil
+            else
+                if not present[k] then live = live + 1 end
+                u[k], present[k] = true, true
+            end
+            if math.random(20) == 1 then collectgarbage() end
+        end
+        assert(count(u) == live)
+    end
+    print("ok")
+end
@@ -0,0 +1,43 @@
+-- Field accesses that the speculative code of luaot guards: sites that see
+-- one table layout and several, keys that are removed, set again and moved
+-- by a rehash, __index metamethods, method calls and a non-table operand.
+-- Every guard failure must fall back to the right result. Raises an error
+-- on failure; compile it with luaot to test the guards.
+
+local function getx(o)
+    return o.x
+end
+
+local function call(o)
+    return o:m()
+end
+
+return function(N)
+    N = N or 100
+    local a = { x = 1, y = 2 }
+    local b = { y = 3, x = 4, z = 5 }
+    local s = 0
+    for i = 1, N do
+        s = s + getx(a) + getx(i % 2 == 0 and a or b)
+    end
+    assert(s == N + (N // 2) * 1 + (N - N // 2) * 4)
+
+    a.x = nil
+    assert(getx(a) == nil)
+    a.x = "again"
+    assert(getx(a) == "again")
+    for i = 1, 40 do a["k" .. i] = i end  -- the rehash moves the key
+    assert(getx(a) == "again" and a.k40 == 40)
+
+    local proxy = setmetatable({}, { __index = function(_, k) return k .. "!" end })
+    assert(getx(proxy) == "x!")
+    assert(getx(setmetatable({}, { __index = b })) == 4)
+
+    local obj = { m = function(self) return self.y end, y = 7 }
+    assert(call(obj) == 7)
+    assert(call(setmetatable({ y = 8 }, { __index = obj })) == 8)
+
+    assert(not pcall(getx, nil))
+    assert(("abc"):upper() == "ABC")
+    print("ok")
+end
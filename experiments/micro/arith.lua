@@ -0,0 +1,18 @@
+-- Arithmetic between registers: OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_IDIV,
+-- OP_MOD, OP_BAND and OP_SHL, on integers and floats.
+return function(N)
+    local x, y = 7, 3
+    local u, v = 2.5, 1.25
+    local r, f = 0, 0.0
+    for _ = 1, N do
+        r = x + y
+        r = x - r
+        r = r * y
+        f = u / v
+        r = x // y
+        r = r % y
+        r = x & y
+        f = u * f
+    end
+    return N * 8, r, f
+end
@@ -0,0 +1,16 @@
+-- Arithmetic with constant operands: OP_ADDI, OP_ADDK, OP_SUBK, OP_MULK,
+-- OP_DIVK, OP_MODK, OP_BANDK and OP_SHRI, on integers and floats.
+return function(N)
+    local r, f = 0, 0.0
+    for _ = 1, N do
+        r = r + 1
+        f = f + 0.5
+        r = r - 3
+        r = r * 5
+        f = f / 2.0
+        r = r % 1000
+        r = r & 0xff
+        r = r >> 1
+    end
+    return N * 8, r, f
+end
@@ -0,0 +1,16 @@
+-- Calls and returns between Lua functions: OP_CALL with fixed arguments and
+-- results, OP_RETURN0, OP_RETURN1 and OP_RETURN.
+local function f0() end
+local function f1(a) return a end
+local function f2(a, b) return a, b end
+
+return function(N)
+    local x, y
+    for _ = 1, N do
+        f0()
+        x = f1(1)
+        x, y = f2(x, 2)
+        f0()
+    end
+    return N * 4, x, y
+end
@@ -0,0 +1,13 @@
+-- Closure creation: OP_CLOSURE with upvalues that come from the stack and
+-- from the enclosing function, and OP_GETUPVAL/OP_SETUPVAL inside them.
+return function(N)
+    local up = 0
+    local f
+    for i = 1, N do
+        f = function() up = up + 1 return up end
+        f = function() return i end
+        f = function() return f end
+        f = function(a) return a end
+    end
+    return N * 4, f
+end
@@ -0,0 +1,18 @@
+-- Comparisons and conditional jumps: OP_LT, OP_LE, OP_EQ, OP_EQK, OP_EQI,
+-- OP_LTI, OP_GTI and OP_TEST.
+return function(N)
+    local a, b = 1, 2
+    local s = "x"
+    local c = 0
+    for _ = 1, N do
+        if a < b then c = c + 1 end
+        if a <= b then c = c + 1 end
+        if a == b then c = c + 1 end
+        if s == "y" then c = c + 1 end
+        if a == 1 then c = c + 1 end
+        if a < 0 then c = c + 1 end
+        if b > 1 then c = c + 1 end
+        if s then c = c + 1 end
+    end
+    return N * 8, c
+end
@@ -0,0 +1,13 @@
+-- String concatenation: OP_CONCAT of constants, strings and numbers.
+return function(N)
+    local a, b = "alpha", "beta"
+    local n = 42
+    local s
+    for _ = 1, N do
+        s = a .. b
+        s = a .. ":" .. n
+        s = "[" .. s .. "]"
+        s = b .. 1.5
+    end
+    return N * 4, s
+end
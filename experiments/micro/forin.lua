@@ -0,0 +1,18 @@
+-- Generic for loops: OP_TFORPREP, OP_TFORCALL and OP_TFORLOOP with ipairs,
+-- pairs and a Lua iterator. Each op is one iteration of an inner loop.
+local function range(n, i)
+    if i < n then return i + 1 end
+end
+
+return function(N)
+    local t = {1, 2, 3, 4, 5, 6, 7, 8}
+    local h = {a = 1, b = 2, c = 3, d = 4, e = 5, f = 6, g = 7, h = 8}
+    local s = 0
+    local m = N // 24
+    for _ = 1, m do
+        for _, v in ipairs(t) do s = s + v end
+        for _, v in pairs(h) do s = s + v end
+        for i in range, 8, 0 do s = s + i end
+    end
+    return m * 24, s
+end
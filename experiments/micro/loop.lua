@@ -0,0 +1,7 @@
+-- Baseline: an empty numeric for loop (OP_FORLOOP).
+-- Subtract it from the other kernels to discount the loop overhead.
+return function(N)
+    for _ = 1, N do
+    end
+    return N
+end
@@ -0,0 +1,16 @@
+-- Moves and loads: OP_MOVE, OP_LOADI, OP_LOADF, OP_LOADK, OP_LOADNIL,
+-- OP_LOADTRUE and OP_LOADFALSE.
+return function(N)
+    local a, b, c, d = 1, 2, 3, 4
+    for _ = 1, N do
+        a = b
+        b = c
+        c = 17
+        d = 1.5
+        a = "str"
+        b = nil
+        c = true
+        d = false
+    end
+    return N * 8
+end
@@ -0,0 +1,18 @@
+-- Table accesses with integer keys: OP_GETI, OP_SETI, and OP_GETTABLE and
+-- OP_SETTABLE with an integer in a register.
+return function(N)
+    local t = {1, 2, 3, 4, 5, 6, 7, 8}
+    local i, j = 3, 6
+    local x
+    for _ = 1, N do
+        x = t[1]
+        t[2] = x
+        x = t[i]
+        t[j] = x
+        x = t[4]
+        t[5] = x
+        x = t[j]
+        t[i] = x
+    end
+    return N * 8, x
+end
@@ -0,0 +1,21 @@
+-- Table accesses with non-constant keys: OP_GETTABLE and OP_SETTABLE with
+-- strings, floats and booleans in registers.
+return function(N)
+    local t = {}
+    local ks, kf, kb = "key", 1.5, true
+    t[ks] = 1
+    t[kf] = 2
+    t[kb] = 3
+    local x
+    for _ = 1, N do
+        x = t[ks]
+        t[kf] = x
+        x = t[kb]
+        t[ks] = x
+        x = t[kf]
+        t[kb] = x
+        x = t[ks]
+        t[kf] = x
+    end
+    return N * 8, x
+end
@@ -0,0 +1,21 @@
+-- Table accesses with constant string keys: OP_GETFIELD, OP_SETFIELD and
+-- OP_GETTABUP.
+local M = {}
+
+function M.get(self) return self end
+
+return function(N)
+    local p = {x = 1, y = 2, z = 3}
+    local x
+    for _ = 1, N do
+        x = p.x
+        p.y = x
+        x = p.z
+        p.x = x
+        x = M.get
+        x = math
+        x = p.y
+        p.z = x
+    end
+    return N * 8, x
+end
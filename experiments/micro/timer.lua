@@ -0,0 +1,19 @@
+-- Runs a microbenchmark kernel in-process and prints one ns/op sample per
+-- line. Each kernel takes an iteration count and returns how many ops it
+-- performed. Like main.lua, it must be run from the experiments directory:
+--
+--     ../src/lua micro/timer.lua micro.arith 1000000 10
+
+local modname = assert(arg[1])
+local N    = tonumber(arg[2]) or 1000000
+local reps = tonumber(arg[3]) or 10
+
+local kernel = require(modname)
+kernel(N)  -- warm up
+
+for _ = 1, reps do
+    local t0 = os.clock()
+    local ops = kernel(N)
+    local t1 = os.clock()
+    print(string.format("%.3f", (t1 - t0) * 1e9 / ops))
+end
@@ -0,0 +1,25 @@
+-- Variable arguments: OP_VARARGPREP, OP_VARARG with fixed and open results,
+-- calls with open arguments and select('#').
+local function count(...)
+    return select('#', ...)
+end
+
+local function first(...)
+    local a = ...
+    return a
+end
+
+local function pass(...)
+    return count(...)
+end
+
+return function(N)
+    local x
+    for _ = 1, N do
+        x = count(1, 2, 3)
+        x = first(x, 2)
+        x = pass(1, x, 3, 4)
+        x = first(x)
+    end
+    return N * 4, x
+end
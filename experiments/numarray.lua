@@ -0,0 +1,29 @@
+-- Large arrays of floats and of integers, too big for the caches: a
+-- prefix sum, a dot product and a histogram. See ../scripts/bench-arrays.
+
+return function(N)
+    N = N or 20
+    local size = 1000000
+    local xs, ys, counts = {}, {}, {}
+    for i = 1, size do
+        xs[i] = i * 0.25
+        ys[i] = (i % 7) * 1.5
+    end
+    for i = 1, 64 do
+        counts[i] = 0
+    end
+    local dot = 0.0
+    for _ = 1, N do
+        for i = 2, size do
+            xs[i] = xs[i] * 0.5 + xs[i - 1] * 0.5
+        end
+        for i = 1, size do
+            dot = dot + xs[i] * ys[i]
+        end
+        for i = 1, size, 16 do
+            local b = math.floor(ys[i]) + 1
+            counts[b] = counts[b] + 1
+        end
+    end
+    print(string.format("%.6e %d %d", dot, counts[1], collectgarbage("count") // 1024))
+end
@@ -0,0 +1,31 @@
+-- Traversals with pairs of a table with string keys, of a table with
+-- float keys and of an array. Prints the time of
+-- each traversal. See ../scripts/bench-pairs.
+
+local function traverse(t, N)
+    local sum = 0
+    for _ = 1, N do
+        for _, v in pairs(t) do
+            sum = sum + v
+        end
+    end
+    return sum
+end
+
+return function(N)
+    N = N or 1000
+    local strs, floats, array = {}, {}, {}
+    for i = 1, 10000 do
+        strs["key" .. i] = i
+        floats[i + 0.5] = i
+        array[i] = i
+    end
+    for _, test in ipairs({{"strings", strs}, {"floats", floats},
+                           {"array", array}}) do
+        collectgarbage()
+        local start = os.clock()
+        local sum = traverse(test[2], N)
+        print(string.format("%-7s %d %.0f ms", test[1], sum,
+                            (os.clock() - start) * 1000))
+    end
+end
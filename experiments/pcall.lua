@@ -0,0 +1,18 @@
+-- Protected calls that do not raise errors, like an RPC layer that wraps
+-- each request in pcall. See ../scripts/bench-pcall.
+
+local function handler(req)
+    return req.x + req.y
+end
+
+return function(N)
+    N = N or 1000000
+    local req = { x = 1, y = 2 }
+    local sum = 0
+    for i = 1, N do
+        req.x = i
+        local ok, res = pcall(handler, req)
+        if ok then sum = sum + res end
+    end
+    print(sum)
+end
@@ -0,0 +1,18 @@
+-- Protected calls where every call raises an error. See ../scripts/bench-pcall.
+
+local function handler(req)
+    if req.x > 0 then error(req) end
+    return req.x
+end
+
+return function(N)
+    N = N or 100000
+    local req = { x = 1 }
+    local nerr = 0
+    for i = 1, N do
+        req.x = i
+        local ok, err = pcall(handler, req)
+        if not ok and err == req then nerr = nerr + 1 end
+    end
+    print(nerr)
+end
@@ -0,0 +1,45 @@
+-- Record-like tables: many small objects with the same few string fields,
+-- created with constructors and by assignment, and read and written from
+-- the same access sites. See ../scripts/bench-shapes.
+
+local function new_particle(i)
+    return { x = i, y = i * 0.5, vx = 1.0, vy = -1.0, alive = true }
+end
+
+local function new_node(i)
+    local n = {}
+    n.id = i
+    n.weight = i % 7
+    n.label = "node"
+    return n
+end
+
+return function(N)
+    N = N or 100
+    local sum = 0
+    for _ = 1, N do
+        local ps = {}
+        for i = 1, 2000 do
+            ps[i] = new_particle(i)
+        end
+        for _ = 1, 10 do
+            for i = 1, #ps do
+                local p = ps[i]
+                p.x = p.x + p.vx
+                p.y = p.y + p.vy
+                if p.y < 0 then p.alive = false end
+            end
+        end
+        local nodes = {}
+        for i = 1, 2000 do
+            nodes[i] = new_node(i)
+        end
+        for i = 1, #nodes do
+            sum = sum + nodes[i].id * nodes[i].weight
+        end
+        for i = 1, #ps do
+            if ps[i].alive then sum = sum + ps[i].x end
+        end
+    end
+    print(sum)
+end
@@ -0,0 +1,41 @@
+-- Scratch tables filled and thrown away in a loop, either created anew
+-- each time or created once with table.new and emptied with table.clear.
+-- Prints the time of each version. See ../scripts/bench-scratch.
+
+local function fresh(N)
+    local sum = 0
+    for i = 1, N do
+        local t = {}
+        for j = 1, 32 do
+            t[j] = i + j
+        end
+        t.first, t.last = t[1], t[32]
+        sum = sum + #t + t.last - t.first
+    end
+    return sum
+end
+
+local function reuse(N)
+    local sum = 0
+    local t = table.new(32, 2)
+    for i = 1, N do
+        for j = 1, 32 do
+            t[j] = i + j
+        end
+        t.first, t.last = t[1], t[32]
+        sum = sum + #t + t.last - t.first
+        table.clear(t)
+    end
+    return sum
+end
+
+return function(N)
+    N = N or 1000000
+    for _, f in ipairs({fresh, reuse}) do
+        collectgarbage()
+        local start = os.clock()
+        local sum = f(N)
+        print(string.format("%s %d %.0f ms", f == fresh and "fresh" or "reuse",
+                            sum, (os.clock() - start) * 1000))
+    end
+end
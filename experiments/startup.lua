@@ -0,0 +1 @@
+return function() end
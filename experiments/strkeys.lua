@@ -0,0 +1,30 @@
+-- String-keyed tables: a dictionary of words with lookups that hit and
+-- miss, plus records with a few string fields. See ../scripts/bench-hash.
+
+return function(N)
+    N = N or 100
+    local words = {}
+    for i = 1, 20000 do
+        words[i] = "word" .. i
+    end
+    local misses = {}
+    for i = 1, 20000 do
+        misses[i] = "miss" .. i
+    end
+    local sum = 0
+    for _ = 1, N do
+        local dict = {}
+        for i = 1, #words do
+            dict[words[i]] = i
+        end
+        for i = 1, #words do
+            sum = sum + dict[words[i]]
+            if dict[misses[i]] then sum = sum + 1 end
+        end
+        for i = 1, #words, 4 do
+            local r = { name = words[i], id = i, score = i * 2, next = dict }
+            sum = sum + r.id + r.score
+        end
+    end
+    print(sum)
+end
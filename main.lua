@@ -0,0 +1 @@
+require(arg[1])()
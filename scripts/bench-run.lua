@@ -10,6 +10,7 @@ do
         elseif arg[i] == "--slow"   then nkey = "slow"
         elseif arg[i] == "--time"   then mode = "time"
         elseif arg[i] == "--perf"   then mode = "perf"
+        elseif arg[i] == "--micro"  then mode = "micro"
         end
         i = i + 1
     end
@@ -30,6 +31,24 @@ local benchs = {
     { name = "spectralnorm", fast = 100, medium =    1000, slow =    4000 },
 }
 
+-- One microbenchmark kernel per opcode family, in the micro directory.
+-- The sizes are iteration counts for micro/timer.lua.
+local micros = {
+    { name = "loop",     fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "move",     fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "arith",    fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "arithk",   fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "compare",  fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "tabint",   fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "tabstr",   fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "tabkey",   fast = 10000, medium = 10000000, slow = 100000000 },
+    { name = "call",     fast = 10000, medium =  1000000, slow =  10000000 },
+    { name = "closure",  fast = 10000, medium =  1000000, slow =  10000000 },
+    { name = "vararg",   fast = 10000, medium =  1000000, slow =  10000000 },
+    { name = "concat",   fast = 10000, medium =  1000000, slow =  10000000 },
+    { name = "forin",    fast = 10000, medium =  1000000, slow =  10000000 },
+}
+
 local impls = {
     { name = "jit", suffix = "",     interpreter = "luajit",        compile = false                    },
     { name = "jof", suffix = "",     interpreter = "luajit -j off", compile = false                    },
@@ -77,12 +96,24 @@ io.stderr:write("Recompiling the compiler...\n")
 assert(run("cd .. && make guess --quiet >&2"))
 io.stderr:write("...done\n")
 
-for _, b in ipairs(benchs) do
-    for _, s in ipairs(impls) do
-        local mod = b.name .. s.suffix
-        if s.compile and not exists(mod .. ".so") then
-            assert(run(s.compile.." %1.lua -o %2.c", b.name, mod))
-            assert(run("../scripts/compile %2.c",    b.name, mod))
+if mode == "micro" then
+    for _, b in ipairs(micros) do
+        for _, s in ipairs(impls) do
+            local mod = "micro/" .. b.name .. s.suffix
+            if s.compile and not exists(mod .. ".so") then
+                assert(run(s.compile.." micro/%1.lua -o %2.c", b.name, mod))
+                assert(run("../scripts/compile %2.c",          b.name, mod))
+            end
+        end
+    end
+else
+    for _, b in ipairs(benchs) do
+        for _, s in ipairs(impls) do
+            local mod = b.name .. s.suffix
+            if s.compile and not exists(mod .. ".so") then
+                assert(run(s.compile.." %1.lua -o %2.c", b.name, mod))
+                assert(run("../scripts/compile %2.c",    b.name, mod))
+            end
         end
     end
 end
@@ -129,6 +160,50 @@ elseif mode == "perf" then
         end
     end
 
+elseif mode == "micro" then
+
+    -- Two-sided 95% quantiles of Student's t distribution, by degrees of
+    -- freedom. Above 30 the normal approximation is good enough.
+    local tquantile = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+         2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+         2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    }
+
+    local function mean_ci(xs)
+        local n = #xs
+        local sum = 0.0
+        for _, x in ipairs(xs) do sum = sum + x end
+        local mean = sum / n
+        if n < 2 then return mean, 0.0 end
+        local ss = 0.0
+        for _, x in ipairs(xs) do ss = ss + (x - mean)^2 end
+        local sd = math.sqrt(ss / (n - 1))
+        return mean, (tquantile[n-1] or 1.960) * sd / math.sqrt(n)
+    end
+
+    local micro_impls = { lua = true, aot = true, trm = true }
+
+    print(string.format("%-10s %-4s %12s %10s", "kernel", "impl", "ns/op", "95% CI"))
+    for _, b in ipairs(micros) do
+        for _, impl in ipairs(impls) do
+            if micro_impls[impl.name] then
+                local n = assert(b[nkey])
+                local cmd = prepare(impl.interpreter .. " micro/timer.lua %1 %2 20",
+                    "micro." .. b.name .. impl.suffix, n)
+                local samples = {}
+                local pipe = assert(io.popen(cmd))
+                for line in pipe:lines() do
+                    samples[#samples+1] = assert(tonumber(line))
+                end
+                assert(pipe:close())
+                local mean, ci = mean_ci(samples)
+                print(string.format("%-10s %-4s %12.3f %10s", b.name, impl.name, mean,
+                    string.format("± %.3f", ci)))
+            end
+        end
+    end
+
 else
     error("impossible")
 end
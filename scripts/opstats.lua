@@ -0,0 +1,120 @@
+#!/usr/bin/lua
+
+-- Runs a Lua script and reports which opcodes, opcode pairs and
+-- instructions it executed the most. It needs an interpreter built with
+-- LUAI_OPCOUNT, for example:
+--
+--     make -C src linux MYCFLAGS=-DLUAI_OPCOUNT
+--     cd experiments
+--     ../src/lua ../scripts/opstats.lua -n 20 main.lua nbody 100000
+--
+-- Only interpreted code is counted, not modules compiled with luaot.
+
+local usage = "usage: lua opstats.lua [-n N] script.lua [args]"
+
+local top = 15
+local script_index = nil
+do
+    local i = 1
+    while i <= #arg do
+        if arg[i] == "-n" then
+            top = assert(math.tointeger(arg[i+1]), usage)
+            i = i + 2
+        else
+            script_index = i
+            break
+        end
+    end
+end
+if not script_index then
+    io.stderr:write(usage, "\n")
+    os.exit(1)
+end
+
+if not debug.opstats() then
+    io.stderr:write("opstats.lua: this interpreter was not built with LUAI_OPCOUNT\n")
+    os.exit(1)
+end
+
+--
+-- Run the script, with its own 'arg' table
+--
+
+local script = arg[script_index]
+local script_arg = { [0] = script }
+for i = script_index + 1, #arg do
+    script_arg[#script_arg + 1] = arg[i]
+end
+
+local chunk = assert(loadfile(script))
+arg = script_arg
+debug.opstats(true)
+chunk(table.unpack(script_arg))
+local stats = debug.opstats()
+
+--
+-- Report
+--
+
+local function sorted(t)
+    local list = {}
+    local total = 0
+    for name, count in pairs(t) do
+        list[#list + 1] = { name = name, count = count }
+        total = total + count
+    end
+    table.sort(list, function(a, b) return a.count > b.count end)
+    return list, total
+end
+
+local function percent(count, total)
+    return 100 * count / total
+end
+
+local source_lines = {}
+local function get_line(source, line)
+    local lines = source_lines[source]
+    if not lines then
+        lines = {}
+        local filename = string.match(source, "^@(.*)$")
+        local f = filename and io.open(filename, "r")
+        if f then
+            for l in f:lines() do lines[#lines + 1] = l end
+            f:close()
+        end
+        source_lines[source] = lines
+    end
+    local text = lines[line] or ""
+    return (string.gsub(text, "^%s+", ""))
+end
+
+local ops, total = sorted(stats.ops)
+print(string.format("%d instructions executed", total))
+
+print()
+print("Opcodes:")
+for i = 1, math.min(top, #ops) do
+    local e = ops[i]
+    print(string.format("  %-14s %14d %6.2f%%", e.name, e.count, percent(e.count, total)))
+end
+
+local pairs_list, total_pairs = sorted(stats.pairs)
+print()
+print("Opcode pairs:")
+for i = 1, math.min(top, #pairs_list) do
+    local e = pairs_list[i]
+    local a, b = string.match(e.name, "^(%S+) (%S+)$")
+    print(string.format("  %-14s %-14s %14d %6.2f%%", a, b, e.count, percent(e.count, total_pairs)))
+end
+
+local instructions = stats.instructions
+table.sort(instructions, function(a, b) return a.count > b.count end)
+print()
+print("Instructions:")
+for i = 1, math.min(top, #instructions) do
+    local e = instructions[i]
+    local source = e.source or "?"
+    local where = string.format("%s:%d", string.match(source, "^[@=]?(.*)$"), e.line)
+    print(string.format("  %-24s pc %-5d %-14s %14d %6.2f%%  %s",
+        where, e.pc, e.op, e.count, percent(e.count, total), get_line(source, e.line)))
+end
@@ -23,6 +23,7 @@
 #include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
+#include "lopcodes.h"
 #include "lstate.h"
 #include "lstring.h"
 #include "ltable.h"
@@ -70,7 +71,7 @@ static TValue *index2value (lua_State *L, int idx) {
   else {  /* upvalues */
     idx = LUA_REGISTRYINDEX - idx;
     api_check(L, idx <= MAXUPVAL + 1, "upvalue index too large");
-    if (ttislcf(s2v(ci->func)))  /* light C function? */
+    if (!ttisCclosure(s2v(ci->func)))  /* light C function? */
       return &G(L)->nilvalue;  /* it has no upvalues */
     else {
       CClosure *func = clCvalue(s2v(ci->func));
@@ -212,6 +213,19 @@ LUA_API void lua_closeslot (lua_State *L, int idx) {
 }
 
 
+/*
+** Tell the VM that 'f' is the library function 'id' (one of the
+** LUA_VMF_* values), so that it can do some calls to it without a
+** CallInfo (see 'luaT_selectvarargs' and 'luaH_tablecall').
+*/
+LUA_API void lua_setvmfunction (lua_State *L, int id, lua_CFunction f) {
+  lua_lock(L);
+  api_check(L, 0 <= id && id < LUA_NUMVMF, "invalid VM function");
+  G(L)->vmfuncs[id] = f;
+  lua_unlock(L);
+}
+
+
 /*
 ** Reverse the stack segment from 'from' to 'to'
 ** (auxiliary to 'lua_rotate')
@@ -290,7 +304,7 @@ LUA_API const char *lua_typename (lua_State *L, int t) {
 
 LUA_API int lua_iscfunction (lua_State *L, int idx) {
   const TValue *o = index2value(L, idx);
-  return (ttislcf(o) || (ttisCclosure(o)));
+  return (ttislightcf(o) || (ttisCclosure(o)));
 }
 
 
@@ -423,7 +437,7 @@ LUA_API lua_Unsigned lua_rawlen (lua_State *L, int idx) {
     case LUA_VSHRSTR: return tsvalue(o)->shrlen;
     case LUA_VLNGSTR: return tsvalue(o)->u.lnglen;
     case LUA_VUSERDATA: return uvalue(o)->len;
-    case LUA_VTABLE: return luaH_getn(hvalue(o));
+    case LUA_VTABLE: return luaH_getn(L, hvalue(o));
     default: return 0;
   }
 }
@@ -431,7 +445,7 @@ LUA_API lua_Unsigned lua_rawlen (lua_State *L, int idx) {
 
 LUA_API lua_CFunction lua_tocfunction (lua_State *L, int idx) {
   const TValue *o = index2value(L, idx);
-  if (ttislcf(o)) return fvalue(o);
+  if (ttislightcf(o)) return fvalue(o);
   else if (ttisCclosure(o))
     return clCvalue(o)->f;
   else return NULL;  /* not a C function */
@@ -469,7 +483,7 @@ LUA_API lua_State *lua_tothread (lua_State *L, int idx) {
 LUA_API const void *lua_topointer (lua_State *L, int idx) {
   const TValue *o = index2value(L, idx);
   switch (ttypetag(o)) {
-    case LUA_VLCF: return cast_voidp(cast_sizet(fvalue(o)));
+    case LUA_VLCF: case LUA_VLEAF: return cast_voidp(cast_sizet(fvalue(o)));
     case LUA_VUSERDATA: case LUA_VLIGHTUSERDATA:
       return touserdata(o);
     default: {
@@ -596,6 +610,20 @@ LUA_API void lua_pushcclosure (lua_State *L, lua_CFunction fn, int n) {
 }
 
 
+/*
+** Push a light C function that the VM may call as a leaf (see
+** 'luaD_callleaf'). The function promises not to yield, not to call Lua
+** functions and not to create to-be-closed variables; it may still raise
+** errors.
+*/
+LUA_API void lua_pushleafcfunction (lua_State *L, lua_CFunction fn) {
+  lua_lock(L);
+  setleafvalue(s2v(L->top), fn);
+  api_incr_top(L);
+  lua_unlock(L);
+}
+
+
 LUA_API void lua_pushboolean (lua_State *L, int b) {
   lua_lock(L);
   if (b)
@@ -1259,6 +1287,51 @@ LUA_API int lua_next (lua_State *L, int idx) {
 }
 
 
+/*
+** Remove all entries of a table, keeping the memory of its parts for
+** the entries that will be inserted later.
+*/
+LUA_API void lua_cleartable (lua_State *L, int idx) {
+  Table *t;
+  lua_lock(L);
+  t = gettable(L, idx);
+  luaH_clear(L, t);
+  lua_unlock(L);
+}
+
+
+/*
+** Copy elements 'f' to 'e' of the table at 'src' to the table at 'dst',
+** starting at position 't', as 'table.move' does, but directly in their
+** array parts (see 'luaH_movearray'). Returns 0, doing nothing, if some
+** element is not in an array part or if metamethods could be called.
+*/
+LUA_API int lua_movearray (lua_State *L, int src, lua_Integer f,
+                           lua_Integer e, int dst, lua_Integer t) {
+  int res;
+  lua_lock(L);
+  api_check(L, f <= e && (f > 0 || e < LUA_MAXINTEGER + f), "invalid range");
+  res = luaH_movearray(L, gettable(L, src), f, e - f + 1, gettable(L, dst), t);
+  lua_unlock(L);
+  return res;
+}
+
+
+/*
+** Set elements 'i' to 'j' of the table at 'idx' to the value at 'vidx',
+** directly in its array part (see 'luaH_fillarray'). Returns 0, doing
+** nothing, if it cannot.
+*/
+LUA_API int lua_fillarray (lua_State *L, int idx, int vidx,
+                           lua_Integer i, lua_Integer j) {
+  int res;
+  lua_lock(L);
+  res = luaH_fillarray(L, gettable(L, idx), index2value(L, vidx), i, j);
+  lua_unlock(L);
+  return res;
+}
+
+
 LUA_API void lua_toclose (lua_State *L, int idx) {
   int nresults;
   StkId o;
@@ -1432,7 +1505,7 @@ LUA_API void *lua_upvalueid (lua_State *L, int fidx, int n) {
         return &f->upvalue[n - 1];
       /* else */
     }  /* FALLTHROUGH */
-    case LUA_VLCF:
+    case LUA_VLCF: case LUA_VLEAF:
       return NULL;  /* light C functions have no upvalues */
     default: {
       api_check(L, 0, "function expected");
@@ -1442,6 +1515,117 @@ LUA_API void *lua_upvalueid (lua_State *L, int fidx, int n) {
 }
 
 
+/*
+** Information about the 'n'-th speculation guard in the AOT code of the
+** function at 'fidx'. Returns 0 if there is no such guard (which is
+** always the case for functions that were not compiled ahead of time).
+*/
+LUA_API int lua_getaotguard (lua_State *L, int fidx, int n, int *pc,
+                                           int *line, unsigned int *failures) {
+  TValue *fi = index2value(L, fidx);
+  Proto *p;
+  api_check(L, ttisfunction(fi), "function expected");
+  if (!ttisLclosure(fi))
+    return 0;
+  p = clLvalue(fi)->p;
+  if (!(1 <= n && n <= p->sizeaot_guards))
+    return 0;
+  *pc = p->aot_guards[n - 1].pc;
+  *line = luaG_getfuncline(p, *pc);
+  *failures = p->aot_guards[n - 1].failures;
+  return 1;
+}
+
+
+/*
+** Information about the 'n'-th inline cache of the Lua function at
+** 'fidx', i.e., its 'n'-th field access with a constant key. Returns 0
+** if there is no such instruction, 1 if only misses are counted and 2
+** if hits are counted too (LUAI_CACHESTATS). Functions that never ran
+** interpreted report no hits and no misses.
+*/
+LUA_API int lua_getinlinecache (lua_State *L, int fidx, int n, int *pc,
+                                int *line, unsigned int *hits,
+                                unsigned int *misses) {
+  TValue *fi = index2value(L, fidx);
+  Proto *p;
+  int i;
+  api_check(L, ttisfunction(fi), "function expected");
+  if (!ttisLclosure(fi))
+    return 0;
+  p = clLvalue(fi)->p;
+  for (i = 0; i < p->sizecode; i++) {
+    switch (unfusedop(GET_OPCODE(p->code[i]))) {
+      case OP_GETTABUP: case OP_GETFIELD: case OP_SELF:
+      case OP_SETTABUP: case OP_SETFIELD: {
+        if (--n == 0) {
+          *pc = i;
+          *line = luaG_getfuncline(p, i);
+          *hits = (p->icache) ? p->icache[i].hits : 0;
+          *misses = (p->icache) ? p->icache[i].misses : 0;
+#if defined(LUAI_CACHESTATS)
+          return 2;
+#else
+          return 1;
+#endif
+        }
+        break;
+      }
+      default: break;
+    }
+  }
+  return 0;
+}
+
+
+/*
+** Numbers of table lengths computed by the state so far that found a
+** border without a search ('hits'), by checking the limit of the array
+** part or the border cached in the table, and that had to do a binary
+** search ('searches'). If 'reset' is true, zeroes both counters after
+** reading them. Returns 1 if hits are counted (LUAI_LENSTATS) and 0
+** otherwise, leaving '*hits' as 0.
+*/
+LUA_API int lua_lenstats (lua_State *L, lua_Unsigned *hits,
+                                        lua_Unsigned *searches, int reset) {
+  global_State *g = G(L);
+  int res;
+  lua_lock(L);
+  *searches = g->lensearches;
+#if defined(LUAI_LENSTATS)
+  *hits = g->lencount - g->lensearches;
+  if (reset)
+    g->lencount = 0;
+  res = 1;
+#else
+  *hits = 0;
+  res = 0;
+#endif
+  if (reset)
+    g->lensearches = 0;
+  lua_unlock(L);
+  return res;
+}
+
+
+/*
+** Collisions in the hash part of the table at 'idx': returns its number
+** of nodes and gives its number of keys and the total and maximum number
+** of probes that searches for these keys do (see 'luaH_hashstats').
+*/
+LUA_API unsigned int lua_gethashstats (lua_State *L, int idx,
+                                       unsigned int *nkeys,
+                                       lua_Unsigned *probes,
+                                       unsigned int *maxprobes) {
+  Table *t;
+  lua_lock(L);
+  t = gettable(L, idx);
+  luaH_hashstats(t, nkeys, probes, maxprobes);
+  lua_unlock(L);
+  return allocsizenode(t);
+}
+
+
 LUA_API void lua_upvaluejoin (lua_State *L, int fidx1, int n1,
                                             int fidx2, int n2) {
   LClosure *f1;
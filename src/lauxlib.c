@@ -940,6 +940,18 @@ LUALIB_API void luaL_setfuncs (lua_State *L, const luaL_Reg *l, int nup) {
 }
 
 
+/*
+** set functions from list 'l' into table at top as leaf C functions
+** (see 'lua_pushleafcfunction')
+*/
+LUALIB_API void luaL_setleaffuncs (lua_State *L, const luaL_Reg *l) {
+  for (; l->name != NULL; l++) {
+    lua_pushleafcfunction(L, l->func);
+    lua_setfield(L, -2, l->name);
+  }
+}
+
+
 /*
 ** ensure that stack[idx][fname] has a table and push that table
 ** into the stack
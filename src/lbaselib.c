@@ -513,10 +513,25 @@ static const luaL_Reg base_funcs[] = {
 };
 
 
+/* functions from 'base_funcs' that can be called as leaf functions */
+static const luaL_Reg base_leaffuncs[] = {
+  {"rawequal", luaB_rawequal},
+  {"rawlen", luaB_rawlen},
+  {"rawget", luaB_rawget},
+  {"type", luaB_type},
+  {NULL, NULL}
+};
+
+
 LUAMOD_API int luaopen_base (lua_State *L) {
   /* open lib into global table */
   lua_pushglobaltable(L);
   luaL_setfuncs(L, base_funcs, 0);
+  luaL_setleaffuncs(L, base_leaffuncs);
+  /* let the VM recognize 'select(x, ...)' (see 'luaT_selectvarargs') */
+  lua_setvmfunction(L, LUA_VMF_SELECT, luaB_select);
+  /* let the VM recognize 'next' in generic for loops (see 'luaH_tfornext') */
+  lua_setvmfunction(L, LUA_VMF_NEXT, luaB_next);
   /* set global _G */
   lua_pushvalue(L, -1);
   lua_setfield(L, -2, LUA_GNAME);
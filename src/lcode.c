@@ -1779,6 +1779,43 @@ static int finaltarget (Instruction *code, int i) {
 }
 
 
+/*
+** Replace the first instruction of some frequent pairs by the equivalent
+** superinstruction. Both instructions stay in place, so jumps and debug
+** information are not affected.
+*/
+static void fusepairs (FuncState *fs) {
+  Instruction *code = fs->f->code;
+  int i;
+  for (i = 0; i + 1 < fs->pc; i++) {
+    OpCode next = GET_OPCODE(code[i + 1]);
+    switch (GET_OPCODE(code[i])) {
+      case OP_MOVE: {
+        if (next == OP_CALL)
+          SET_OPCODE(code[i], OP_MOVECALL);
+        break;
+      }
+      case OP_GETUPVAL: {
+        if (next == OP_MOVE)
+          SET_OPCODE(code[i], OP_GETUPVALMOVE);
+        break;
+      }
+      case OP_GETFIELD: {
+        if (next == OP_GETFIELD)
+          SET_OPCODE(code[i], OP_GETFIELD2);
+        break;
+      }
+      case OP_SETFIELD: {
+        if (next == OP_GETFIELD)
+          SET_OPCODE(code[i], OP_SETFIELDGET);
+        break;
+      }
+      default: break;
+    }
+  }
+}
+
+
 /*
 ** Do a final pass over the code of a function, doing small peephole
 ** optimizations and adjustments.
@@ -1811,4 +1848,5 @@ void luaK_finish (FuncState *fs) {
       default: break;
     }
   }
+  fusepairs(fs);
 }
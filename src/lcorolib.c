@@ -189,6 +189,36 @@ static int luaB_close (lua_State *L) {
 }
 
 
+/*
+** Close a dead or suspended coroutine, as 'coroutine.close', and give
+** it a new body, so that it can be resumed again as a new coroutine
+** without creating another thread.
+*/
+static int luaB_recycle (lua_State *L) {
+  lua_State *co = getco(L);
+  int status = auxstatus(L, co);
+  luaL_checktype(L, 2, LUA_TFUNCTION);
+  switch (status) {
+    case COS_DEAD: case COS_YIELD: {
+      status = lua_resetthread(co);
+      if (status == LUA_OK) {
+        lua_pushvalue(L, 2);
+        lua_xmove(L, co, 1);  /* move function to coroutine */
+        lua_pushboolean(L, 1);
+        return 1;
+      }
+      else {
+        lua_pushboolean(L, 0);
+        lua_xmove(co, L, 1);  /* copy error message */
+        return 2;
+      }
+    }
+    default:  /* normal or running coroutine */
+      return luaL_error(L, "cannot recycle a %s coroutine", statname[status]);
+  }
+}
+
+
 static const luaL_Reg co_funcs[] = {
   {"create", luaB_cocreate},
   {"resume", luaB_coresume},
@@ -198,6 +228,7 @@ static const luaL_Reg co_funcs[] = {
   {"yield", luaB_yield},
   {"isyieldable", luaB_yieldable},
   {"close", luaB_close},
+  {"recycle", luaB_recycle},
   {NULL, NULL}
 };
 
@@ -305,6 +305,113 @@ static int db_upvalueid (lua_State *L) {
 }
 
 
+/*
+** Statistics of the speculation guards in the AOT code of a function: a
+** list with the 'pc', 'line' and number of 'failures' of each guard.
+*/
+static int db_getaotstats (lua_State *L) {
+  int n, pc, line;
+  unsigned int failures;
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+  lua_newtable(L);
+  for (n = 1; lua_getaotguard(L, 1, n, &pc, &line, &failures); n++) {
+    lua_createtable(L, 0, 3);
+    lua_pushinteger(L, pc);
+    lua_setfield(L, -2, "pc");
+    lua_pushinteger(L, line);
+    lua_setfield(L, -2, "line");
+    lua_pushinteger(L, failures);
+    lua_setfield(L, -2, "failures");
+    lua_rawseti(L, -2, n);
+  }
+  return 1;
+}
+
+
+/*
+** Statistics of the inline caches used by the interpreter for a function:
+** a list with the 'pc', 'line' and numbers of 'misses' and (if the build
+** counts them) 'hits' of each field access with a constant key.
+*/
+static int db_getcachestats (lua_State *L) {
+  int n, pc, line, res;
+  unsigned int hits, misses;
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+  lua_newtable(L);
+  for (n = 1; (res = lua_getinlinecache(L, 1, n, &pc, &line,
+                                           &hits, &misses)) != 0; n++) {
+    lua_createtable(L, 0, 4);
+    lua_pushinteger(L, pc);
+    lua_setfield(L, -2, "pc");
+    lua_pushinteger(L, line);
+    lua_setfield(L, -2, "line");
+    if (res == 2) {
+      lua_pushinteger(L, hits);
+      lua_setfield(L, -2, "hits");
+    }
+    lua_pushinteger(L, misses);
+    lua_setfield(L, -2, "misses");
+    lua_rawseti(L, -2, n);
+  }
+  return 1;
+}
+
+
+/*
+** debug.opstats([reset]): the execution counters of an interpreter built
+** with LUAI_OPCOUNT (see 'lua_opstats'); with a true argument, resets
+** them instead. Returns fail if the interpreter does not count.
+*/
+static int db_opstats (lua_State *L) {
+  int reset = lua_toboolean(L, 1);
+  if (!lua_opstats(L, reset))
+    luaL_pushfail(L);
+  else if (reset)
+    return 0;
+  return 1;
+}
+
+
+/*
+** debug.lenstats([reset]): how many table lengths found a border without
+** a search (fail, unless the build counts them) and how many had to
+** search for it (see 'lua_lenstats'); with a true argument, also resets
+** both counts.
+*/
+static int db_lenstats (lua_State *L) {
+  lua_Unsigned hits, searches;
+  if (lua_lenstats(L, &hits, &searches, lua_toboolean(L, 1)))
+    lua_pushinteger(L, (lua_Integer)hits);
+  else
+    luaL_pushfail(L);
+  lua_pushinteger(L, (lua_Integer)searches);
+  return 2;
+}
+
+
+/*
+** Collisions in the hash part of a table: its number of 'nodes' and of
+** 'keys', and the mean and maximum number of probes of a search for one
+** of these keys ('meanprobes' and 'maxprobes').
+*/
+static int db_gethashstats (lua_State *L) {
+  unsigned int size, nkeys, maxprobes;
+  lua_Unsigned probes;
+  luaL_checktype(L, 1, LUA_TTABLE);
+  size = lua_gethashstats(L, 1, &nkeys, &probes, &maxprobes);
+  lua_createtable(L, 0, 4);
+  lua_pushinteger(L, size);
+  lua_setfield(L, -2, "nodes");
+  lua_pushinteger(L, nkeys);
+  lua_setfield(L, -2, "keys");
+  lua_pushnumber(L, nkeys > 0 ? (lua_Number)probes / nkeys : 0);
+  lua_setfield(L, -2, "meanprobes");
+  lua_pushinteger(L, maxprobes);
+  lua_setfield(L, -2, "maxprobes");
+  return 1;
+}
+
+
 static int db_upvaluejoin (lua_State *L) {
   int n1, n2;
   checkupval(L, 1, 2, &n1);
@@ -456,12 +563,17 @@ static int db_setcstacklimit (lua_State *L) {
 
 static const luaL_Reg dblib[] = {
   {"debug", db_debug},
+  {"getaotstats", db_getaotstats},
+  {"getcachestats", db_getcachestats},
+  {"gethashstats", db_gethashstats},
   {"getuservalue", db_getuservalue},
   {"gethook", db_gethook},
   {"getinfo", db_getinfo},
   {"getlocal", db_getlocal},
   {"getregistry", db_getregistry},
   {"getmetatable", db_getmetatable},
+  {"lenstats", db_lenstats},
+  {"opstats", db_opstats},
   {"getupvalue", db_getupvalue},
   {"upvaluejoin", db_upvaluejoin},
   {"upvalueid", db_upvalueid},
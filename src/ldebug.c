@@ -410,6 +410,176 @@ LUA_API int lua_getinfo (lua_State *L, const char *what, lua_Debug *ar) {
 }
 
 
+/*
+** {======================================================
+** Instruction counters (LUAI_OPCOUNT)
+** =======================================================
+*/
+
+#if defined(LUAI_OPCOUNT)
+
+#include "lgc.h"
+#include "lopnames.h"
+
+
+static Table *pushtable (lua_State *L) {
+  Table *t = luaH_new(L);
+  sethvalue2s(L, L->top, t);
+  api_incr_top(L);
+  return t;
+}
+
+
+/* t[k] = v, where 'k' is the string on the top of the stack (popped) */
+static void settopfield (lua_State *L, Table *t, TValue *v) {
+  TValue *k = s2v(L->top - 1);
+  luaH_set(L, t, k, v);
+  luaC_barrierback(L, obj2gco(t), k);
+  luaC_barrierback(L, obj2gco(t), v);
+  L->top--;
+}
+
+
+static void setcount (lua_State *L, Table *t, const char *k,
+                      lua_Unsigned n) {
+  TValue v;
+  setivalue(&v, l_castU2S(n));
+  luaO_pushfstring(L, "%s", k);
+  settopfield(L, t, &v);
+}
+
+
+/*
+** Push an entry of the 'instructions' list, for instruction 'pc' of
+** live prototype 'p'.
+*/
+static void pushinstruction (lua_State *L, Proto *p, int pc) {
+  TValue v;
+  Table *t = pushtable(L);
+  if (p->source) {
+    setsvalue(L, &v, p->source);
+    luaO_pushfstring(L, "source");
+    settopfield(L, t, &v);
+  }
+  setcount(L, t, "linedefined", cast(lua_Unsigned, p->linedefined));
+  setcount(L, t, "line", cast(lua_Unsigned, luaG_getfuncline(p, pc)));
+  setcount(L, t, "pc", cast(lua_Unsigned, pc));
+  setcount(L, t, "count", p->opcounts[pc]);
+  luaO_pushfstring(L, "%s", opnames[GET_OPCODE(p->code[pc])]);
+  setobj(L, &v, s2v(L->top - 1));
+  luaO_pushfstring(L, "op");
+  settopfield(L, t, &v);
+  L->top--;  /* remove opcode name */
+}
+
+
+/*
+** Build the table returned by 'lua_opstats'. It walks the 'allgc' list
+** looking for prototypes, so no collection may run meanwhile (see
+** 'lua_opstats').
+*/
+static void collectopstats (lua_State *L, void *ud) {
+  global_State *g = G(L);
+  OpStats *os = &g->opstats;
+  Table *res, *t;
+  GCObject *o;
+  int a, b;
+  lua_Integer n = 0;
+  UNUSED(ud);
+  res = pushtable(L);
+  t = pushtable(L);
+  for (a = 0; a < NUM_OPCODES; a++) {
+    if (os->ops[a] != 0)
+      setcount(L, t, opnames[a], os->ops[a]);
+  }
+  luaO_pushfstring(L, "ops");
+  settopfield(L, res, s2v(L->top - 2));
+  L->top--;  /* remove 'ops' table */
+  t = pushtable(L);
+  for (a = 0; a < NUM_OPCODES; a++) {
+    for (b = 0; b < NUM_OPCODES; b++) {
+      if (os->pairs[a][b] != 0) {
+        TValue v;
+        setivalue(&v, l_castU2S(os->pairs[a][b]));
+        luaO_pushfstring(L, "%s %s", opnames[a], opnames[b]);
+        settopfield(L, t, &v);
+      }
+    }
+  }
+  luaO_pushfstring(L, "pairs");
+  settopfield(L, res, s2v(L->top - 2));
+  L->top--;  /* remove 'pairs' table */
+  t = pushtable(L);
+  for (o = g->allgc; o != NULL; o = o->next) {
+    if (o->tt == LUA_VPROTO && !isdead(g, o) && gco2p(o)->opcounts) {
+      Proto *p = gco2p(o);
+      int pc;
+      for (pc = 0; pc < p->sizecode; pc++) {
+        if (p->opcounts[pc] != 0) {
+          pushinstruction(L, p, pc);
+          luaH_setint(L, t, ++n, s2v(L->top - 1));
+          luaC_barrierback(L, obj2gco(t), s2v(L->top - 1));
+          L->top--;
+        }
+      }
+    }
+  }
+  luaO_pushfstring(L, "instructions");
+  settopfield(L, res, s2v(L->top - 2));
+  L->top--;  /* remove 'instructions' list */
+}
+
+
+static void resetopstats (global_State *g) {
+  GCObject *o;
+  memset(&g->opstats, 0, sizeof(g->opstats));
+  for (o = g->allgc; o != NULL; o = o->next) {
+    if (o->tt == LUA_VPROTO && gco2p(o)->opcounts)
+      memset(gco2p(o)->opcounts, 0,
+             sizeof(lua_Unsigned) * cast_sizet(gco2p(o)->sizecode));
+  }
+}
+
+#endif
+
+
+/*
+** If the interpreter counts instructions (LUAI_OPCOUNT), either resets
+** all counters or pushes a table with them, and returns 1. The table
+** has the executions of each opcode ('ops', indexed by name), of each
+** pair of consecutive opcodes ('pairs', indexed by both names separated
+** by a space) and a list of the instructions executed at least once
+** ('instructions'), with their 'source', 'linedefined', 'line', 'pc'
+** (0-based), 'op' and 'count'. Otherwise, returns 0.
+*/
+LUA_API int lua_opstats (lua_State *L, int reset) {
+#if defined(LUAI_OPCOUNT)
+  global_State *g = G(L);
+  lua_lock(L);
+  if (reset)
+    resetopstats(g);
+  else {
+    /* an emergency collection would free objects from the list being
+       walked, so stop it and restore it even in case of errors */
+    lu_byte stopem = g->gcstopem;
+    int status;
+    g->gcstopem = 1;
+    status = luaD_rawrunprotected(L, collectopstats, NULL);
+    g->gcstopem = stopem;
+    if (l_unlikely(status != LUA_OK))
+      luaD_throw(L, status);
+  }
+  lua_unlock(L);
+  return 1;
+#else
+  UNUSED(L); UNUSED(reset);
+  return 0;
+#endif
+}
+
+/* }====================================================== */
+
+
 /*
 ** {======================================================
 ** Symbolic Execution
@@ -469,7 +639,7 @@ static int findsetreg (const Proto *p, int lastpc, int reg) {
     lastpc--;  /* previous instruction was not actually executed */
   for (pc = 0; pc < lastpc; pc++) {
     Instruction i = p->code[pc];
-    OpCode op = GET_OPCODE(i);
+    OpCode op = unfusedop(GET_OPCODE(i));
     int a = GETARG_A(i);
     int change;  /* true if current instruction changed 'reg' */
     switch (op) {
@@ -532,7 +702,7 @@ static const char *getobjname (const Proto *p, int lastpc, int reg,
   pc = findsetreg(p, lastpc, reg);
   if (pc != -1) {  /* could find instruction? */
     Instruction i = p->code[pc];
-    OpCode op = GET_OPCODE(i);
+    OpCode op = unfusedop(GET_OPCODE(i));
     switch (op) {
       case OP_MOVE: {
         int b = GETARG_B(i);  /* move from 'b' to 'a' */
@@ -600,7 +770,7 @@ static const char *funcnamefromcode (lua_State *L, CallInfo *ci,
     *name = "?";
     return "hook";
   }
-  switch (GET_OPCODE(i)) {
+  switch (unfusedop(GET_OPCODE(i))) {
     case OP_CALL:
     case OP_TAILCALL:
       return getobjname(p, pc, GETARG_A(i), name);  /* get function name */
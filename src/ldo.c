@@ -14,6 +14,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(LUA_USE_MMAPSTACK)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "lua.h"
 
 #include "lapi.h"
@@ -157,6 +162,68 @@ int luaD_rawrunprotected (lua_State *L, Pfunc f, void *ud) {
 ** Stack reallocation
 ** ===================================================================
 */
+
+/* some space for error handling */
+#define ERRORSTACKSIZE	(LUAI_MAXSTACK + 200)
+
+
+#if defined(LUA_USE_MMAPSTACK)
+
+#if !defined(MAP_NORESERVE)
+#define MAP_NORESERVE	0
+#endif
+
+/* address space reserved for each stack: its largest possible size */
+#define STACKRESERVE	(cast_sizet(ERRORSTACKSIZE + EXTRA_STACK) * sizeof(StackValue))
+
+
+/*
+** Reserve the largest stack a thread may need. Its pages are only
+** committed when touched, so 'size' is just what the caller will use.
+*/
+StkId luaD_newstack (lua_State *L, int size) {
+  void *block = mmap(NULL, STACKRESERVE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  lua_assert(cast_sizet(size) * sizeof(StackValue) <= STACKRESERVE);
+  UNUSED(size);
+  if (l_unlikely(block == MAP_FAILED))
+    luaM_error(L);
+  return cast(StkId, block);
+}
+
+
+void luaD_freestack (lua_State *L, StkId stack, int size) {
+  UNUSED(L); UNUSED(size);
+  munmap(stack, STACKRESERVE);
+}
+
+
+/*
+** The stack never moves, so there is nothing to correct: growing it
+** only erases the new segment, and shrinking it gives the pages past
+** the new end back to the system.
+*/
+int luaD_reallocstack (lua_State *L, int newsize, int raiseerror) {
+  int oldsize = stacksize(L);
+  int i;
+  UNUSED(raiseerror);
+  lua_assert(newsize <= LUAI_MAXSTACK || newsize == ERRORSTACKSIZE);
+  for (i = oldsize + EXTRA_STACK; i < newsize + EXTRA_STACK; i++)
+    setnilvalue(s2v(L->stack + i)); /* erase new segment */
+  if (newsize < oldsize) {
+    size_t pagesize = cast_sizet(sysconf(_SC_PAGESIZE));
+    char *limit = cast_charp(L->stack + newsize + EXTRA_STACK);
+    char *end = cast_charp(L->stack + oldsize + EXTRA_STACK);
+    char *first = cast_charp(((cast_sizet(limit) + pagesize - 1) / pagesize) * pagesize);
+    if (first < end)  /* any whole page to release? */
+      madvise(first, cast_sizet(end - first), MADV_DONTNEED);
+  }
+  L->stack_last = L->stack + newsize;
+  return 1;
+}
+
+#else
+
 static void correctstack (lua_State *L, StkId oldstack, StkId newstack) {
   CallInfo *ci;
   UpVal *up;
@@ -173,10 +240,6 @@ static void correctstack (lua_State *L, StkId oldstack, StkId newstack) {
 }
 
 
-/* some space for error handling */
-#define ERRORSTACKSIZE	(LUAI_MAXSTACK + 200)
-
-
 /*
 ** Reallocate the stack to a new size, correcting all pointers into
 ** it. (There are pointers to a stack from its upvalues, from its list
@@ -211,6 +274,8 @@ int luaD_reallocstack (lua_State *L, int newsize, int raiseerror) {
   return 1;
 }
 
+#endif
+
 
 /*
 ** Try to grow the stack by at least 'n' elements. when 'raiseerror'
@@ -370,7 +435,7 @@ static void rethook (lua_State *L, CallInfo *ci, int nres) {
     if (isLua(ci)) {
       Proto *p = ci_func(ci)->p;
       if (p->is_vararg)
-        delta = ci->u.l.nextraargs + p->numparams + 1;
+        delta = ci->u.l.delta;
     }
     ci->func += delta;  /* if vararg, back to virtual 'func' */
     ftransfer = cast(unsigned short, firstres - ci->func);
@@ -513,6 +578,7 @@ CallInfo *luaD_precall (lua_State *L, StkId func, int nresults) {
       f = clCvalue(s2v(func))->f;
       goto Cfunc;
     case LUA_VLCF:  /* light C function */
+    case LUA_VLEAF:  /* leaf light C function (with hooks) */
       f = fvalue(s2v(func));
      Cfunc: {
       int n;  /* number of returns */
@@ -562,6 +628,44 @@ CallInfo *luaD_precall (lua_State *L, StkId func, int nresults) {
 }
 
 
+/*
+** Call a leaf C function (see 'lua_pushleafcfunction') when there are
+** no hooks. The function still needs a CallInfo, for the API and for
+** error messages, but as it cannot yield nor create to-be-closed
+** variables, the call skips the dispatch and the hook tests of
+** 'luaD_precall' and 'luaD_poscall'.
+*/
+void luaD_callleaf (lua_State *L, StkId func, int nresults) {
+  lua_CFunction f = fvalue(s2v(func));
+  CallInfo *ci;
+  int n;  /* number of returns */
+  lua_assert(!L->hookmask);
+  checkstackGCp(L, LUA_MINSTACK, func);  /* ensure minimum stack size */
+  L->ci = ci = next_ci(L);
+  ci->nresults = nresults;
+  ci->callstatus = CIST_C;
+  ci->top = L->top + LUA_MINSTACK;
+  ci->func = func;
+  lua_assert(ci->top <= L->stack_last);
+  lua_unlock(L);
+  n = (*f)(L);  /* do the actual call */
+  lua_lock(L);
+  api_checknelems(L, n);
+  lua_assert(ci->nresults == nresults);  /* no to-be-closed variables */
+  L->ci = ci->previous;
+  func = ci->func;  /* function may have reallocated the stack */
+  if (l_likely(nresults == 1)) {  /* most common case */
+    if (n == 0)
+      setnilvalue(s2v(func));
+    else
+      setobjs2s(L, func, L->top - n);
+    L->top = func + 1;
+  }
+  else
+    moveresults(L, func, n, nresults);
+}
+
+
 /*
 ** Call a function (C or Lua) through C. 'inc' can be 1 (increment
 ** number of recursive invocations in the C stack) or nyci (the same
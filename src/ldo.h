@@ -49,6 +49,16 @@
 	luaD_checkstackaux(L, (fsize), luaC_checkGC(L), (void)0)
 
 
+/* allocation and release of the stack array of a thread */
+#if defined(LUA_USE_MMAPSTACK)
+LUAI_FUNC StkId luaD_newstack (lua_State *L, int size);
+LUAI_FUNC void luaD_freestack (lua_State *L, StkId stack, int size);
+#else
+#define luaD_newstack(L,n)	luaM_newvector(L, n, StackValue)
+#define luaD_freestack(L,s,n)	luaM_freearray(L, s, n)
+#endif
+
+
 /* type of protected functions, to be ran by 'runprotected' */
 typedef void (*Pfunc) (lua_State *L, void *ud);
 
@@ -60,6 +70,7 @@ LUAI_FUNC void luaD_hook (lua_State *L, int event, int line,
 LUAI_FUNC void luaD_hookcall (lua_State *L, CallInfo *ci);
 LUAI_FUNC void luaD_pretailcall (lua_State *L, CallInfo *ci, StkId func, int n);
 LUAI_FUNC CallInfo *luaD_precall (lua_State *L, StkId func, int nResults);
+LUAI_FUNC void luaD_callleaf (lua_State *L, StkId func, int nResults);
 LUAI_FUNC void luaD_call (lua_State *L, StkId func, int nResults);
 LUAI_FUNC void luaD_callnoyield (lua_State *L, StkId func, int nResults);
 LUAI_FUNC void luaD_tryfuncTM (lua_State *L, StkId func);
@@ -261,6 +261,13 @@ Proto *luaF_newproto (lua_State *L) {
   f->lastlinedefined = 0;
   f->source = NULL;
   f->aot_implementation = NULL;
+  f->aot_guards = NULL;
+  f->sizeaot_guards = 0;
+  f->icache = NULL;
+#if defined(LUAI_OPCOUNT)
+  f->opcounts = NULL;
+#endif
+  f->cache = NULL;
   return f;
 }
 
@@ -273,10 +280,42 @@ void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->abslineinfo, f->sizeabslineinfo);
   luaM_freearray(L, f->locvars, f->sizelocvars);
   luaM_freearray(L, f->upvalues, f->sizeupvalues);
+  if (f->icache)
+    luaM_freearray(L, f->icache, f->sizecode);
+#if defined(LUAI_OPCOUNT)
+  if (f->opcounts)
+    luaM_freearray(L, f->opcounts, f->sizecode);
+#endif
   luaM_free(L, f);
 }
 
 
+/*
+** Create the inline caches of a prototype, which only the interpreter
+** uses, so functions that never run interpreted do not pay for them.
+** A new cache points to the first node, so it can only hit on a table
+** that really has the key there. The instruction counters of LUAI_OPCOUNT
+** are created at the same time (first, as 'icache' marks both as done).
+*/
+void luaF_initcache (lua_State *L, Proto *f) {
+  int i;
+  InlineCache *ic;
+#if defined(LUAI_OPCOUNT)
+  if (f->opcounts == NULL) {
+    f->opcounts = luaM_newvectorchecked(L, f->sizecode, lua_Unsigned);
+    for (i = 0; i < f->sizecode; i++)
+      f->opcounts[i] = 0;
+  }
+#endif
+  ic = luaM_newvectorchecked(L, f->sizecode, InlineCache);
+  for (i = 0; i < f->sizecode; i++) {
+    ic[i].idx = 0;
+    ic[i].hits = ic[i].misses = 0;
+  }
+  f->icache = ic;
+}
+
+
 /*
 ** Look for n-th local variable at line 'line' in function 'func'.
 ** Returns NULL if not found.
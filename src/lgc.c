@@ -431,6 +431,61 @@ static void genlink (global_State *g, GCObject *o) {
 }
 
 
+#if defined(LUAI_SHAPES)
+
+/* number of slots in use by table 'h' */
+#define nslots(h)	((h)->shape != NULL ? (h)->shape->nkeys : 0)
+
+/*
+** Mark the keys in the shape of table 'h'. They are strings, which are
+** never weak, so this is done for all tables.
+*/
+static void markshape (global_State *g, Table *h) {
+  int i;
+  for (i = 0; i < nslots(h); i++)
+    markobject(g, h->shape->keys[i]);
+}
+
+#else
+
+#define nslots(h)	0
+
+#endif
+
+
+/* size of the part of the array of 'h' that can hold collectable values */
+#define gcasize(h)	(isarraytyped(h) ? 0 : luaH_realasize(h))
+
+
+#if defined(LUAI_INCREHASH)
+#define oldnodes(h)	(isrehashing(h) ? sizeoldnode(h) : 0)
+#else
+#define oldnodes(h)	0
+#endif
+
+
+/*
+** Get in '*n' and '*limit' the bounds of node array 'a' of table 'h',
+** or return 0 if there is no such array. A table that is rehashing (see
+** 'ltable.c') has a second array, with its old nodes.
+*/
+static int getnodes (Table *h, int a, Node **n, Node **limit) {
+  if (a == 0) {
+    *n = gnode(h, 0);
+    *limit = gnodelast(h);
+    return 1;
+  }
+#if defined(LUAI_INCREHASH)
+  else if (a == 1 && isrehashing(h)) {
+    *n = h->oldnode;
+    *limit = h->oldnode + sizeoldnode(h);
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+
 /*
 ** Traverse a table with weak values and link it to proper list. During
 ** propagate phase, keep it in 'grayagain' list, to be revisited in the
@@ -438,18 +493,21 @@ static void genlink (global_State *g, GCObject *o) {
 ** put it in 'weak' list, to be cleared.
 */
 static void traverseweakvalue (global_State *g, Table *h) {
-  Node *n, *limit = gnodelast(h);
+  Node *n, *limit;
+  int a;
   /* if there is array part, assume it may have white values (it is not
      worth traversing it now just to check) */
-  int hasclears = (h->alimit > 0);
-  for (n = gnode(h, 0); n < limit; n++) {  /* traverse hash part */
-    if (isempty(gval(n)))  /* entry is empty? */
-      clearkey(n);  /* clear its key */
-    else {
-      lua_assert(!keyisnil(n));
-      markkey(g, n);
-      if (!hasclears && iscleared(g, gcvalueN(gval(n))))  /* a white value? */
-        hasclears = 1;  /* table will have to be cleared */
+  int hasclears = (h->alimit > 0 || nslots(h) > 0);
+  for (a = 0; getnodes(h, a, &n, &limit); a++) {  /* traverse hash part */
+    for (; n < limit; n++) {
+      if (isempty(gval(n)))  /* entry is empty? */
+        clearkey(n);  /* clear its key */
+      else {
+        lua_assert(!keyisnil(n));
+        markkey(g, n);
+        if (!hasclears && iscleared(g, gcvalueN(gval(n))))  /* a white value? */
+          hasclears = 1;  /* table will have to be cleared */
+      }
     }
   }
   if (g->gcstate == GCSatomic && hasclears)
@@ -476,8 +534,9 @@ static int traverseephemeron (global_State *g, Table *h, int inv) {
   int hasclears = 0;  /* true if table has white keys */
   int hasww = 0;  /* true if table has entry "white-key -> white-value" */
   unsigned int i;
-  unsigned int asize = luaH_realasize(h);
-  unsigned int nsize = sizenode(h);
+  unsigned int asize = gcasize(h);
+  Node *first, *limit;
+  int a;
   /* traverse array part */
   for (i = 0; i < asize; i++) {
     if (valiswhite(&h->array[i])) {
@@ -485,20 +544,32 @@ static int traverseephemeron (global_State *g, Table *h, int inv) {
       reallymarkobject(g, gcvalue(&h->array[i]));
     }
   }
+#if defined(LUAI_SHAPES)
+  /* traverse slots (whose keys are strings, so never weak) */
+  for (i = 0; i < cast_uint(nslots(h)); i++) {
+    if (valiswhite(&h->slots[i])) {
+      marked = 1;
+      reallymarkobject(g, gcvalue(&h->slots[i]));
+    }
+  }
+#endif
   /* traverse hash part; if 'inv', traverse descending
      (see 'convergeephemerons') */
-  for (i = 0; i < nsize; i++) {
-    Node *n = inv ? gnode(h, nsize - 1 - i) : gnode(h, i);
-    if (isempty(gval(n)))  /* entry is empty? */
-      clearkey(n);  /* clear its key */
-    else if (iscleared(g, gckeyN(n))) {  /* key is not marked (yet)? */
-      hasclears = 1;  /* table must be cleared */
-      if (valiswhite(gval(n)))  /* value not marked yet? */
-        hasww = 1;  /* white-white entry */
-    }
-    else if (valiswhite(gval(n))) {  /* value not marked yet? */
-      marked = 1;
-      reallymarkobject(g, gcvalue(gval(n)));  /* mark it now */
+  for (a = 0; getnodes(h, a, &first, &limit); a++) {
+    unsigned int nsize = cast_uint(limit - first);
+    for (i = 0; i < nsize; i++) {
+      Node *n = inv ? first + (nsize - 1 - i) : first + i;
+      if (isempty(gval(n)))  /* entry is empty? */
+        clearkey(n);  /* clear its key */
+      else if (iscleared(g, gckeyN(n))) {  /* key is not marked (yet)? */
+        hasclears = 1;  /* table must be cleared */
+        if (valiswhite(gval(n)))  /* value not marked yet? */
+          hasww = 1;  /* white-white entry */
+      }
+      else if (valiswhite(gval(n))) {  /* value not marked yet? */
+        marked = 1;
+        reallymarkobject(g, gcvalue(gval(n)));  /* mark it now */
+      }
     }
   }
   /* link table into proper list */
@@ -515,18 +586,25 @@ static int traverseephemeron (global_State *g, Table *h, int inv) {
 
 
 static void traversestrongtable (global_State *g, Table *h) {
-  Node *n, *limit = gnodelast(h);
+  Node *n, *limit;
+  int a;
   unsigned int i;
-  unsigned int asize = luaH_realasize(h);
+  unsigned int asize = gcasize(h);
   for (i = 0; i < asize; i++)  /* traverse array part */
     markvalue(g, &h->array[i]);
-  for (n = gnode(h, 0); n < limit; n++) {  /* traverse hash part */
-    if (isempty(gval(n)))  /* entry is empty? */
-      clearkey(n);  /* clear its key */
-    else {
-      lua_assert(!keyisnil(n));
-      markkey(g, n);
-      markvalue(g, gval(n));
+#if defined(LUAI_SHAPES)
+  for (i = 0; i < cast_uint(nslots(h)); i++)  /* traverse slots */
+    markvalue(g, &h->slots[i]);
+#endif
+  for (a = 0; getnodes(h, a, &n, &limit); a++) {  /* traverse hash part */
+    for (; n < limit; n++) {
+      if (isempty(gval(n)))  /* entry is empty? */
+        clearkey(n);  /* clear its key */
+      else {
+        lua_assert(!keyisnil(n));
+        markkey(g, n);
+        markvalue(g, gval(n));
+      }
     }
   }
   genlink(g, obj2gco(h));
@@ -537,6 +615,9 @@ static lu_mem traversetable (global_State *g, Table *h) {
   const char *weakkey, *weakvalue;
   const TValue *mode = gfasttm(g, h->metatable, TM_MODE);
   markobjectN(g, h->metatable);
+#if defined(LUAI_SHAPES)
+  markshape(g, h);
+#endif
   if (mode && ttisstring(mode) &&  /* is there a weak mode? */
       (cast_void(weakkey = strchr(svalue(mode), 'k')),
        cast_void(weakvalue = strchr(svalue(mode), 'v')),
@@ -550,7 +631,7 @@ static lu_mem traversetable (global_State *g, Table *h) {
   }
   else  /* not weak */
     traversestrongtable(g, h);
-  return 1 + h->alimit + 2 * allocsizenode(h);
+  return 1 + h->alimit + nslots(h) + 2 * (allocsizenode(h) + oldnodes(h));
 }
 
 
@@ -567,10 +648,13 @@ static int traverseudata (global_State *g, Udata *u) {
 /*
 ** Traverse a prototype. (While a prototype is being build, its
 ** arrays can be larger than needed; the extra slots are filled with
-** NULL, so the use of 'markobjectN')
+** NULL, so the use of 'markobjectN'.) The closure cached for AOT code
+** is a weak reference.
 */
 static int traverseproto (global_State *g, Proto *f) {
   int i;
+  if (f->cache && iswhite(f->cache))
+    f->cache = NULL;  /* allow cache to be collected */
   markobjectN(g, f->source);
   for (i = 0; i < f->sizek; i++)  /* mark literals */
     markvalue(g, &f->k[i]);
@@ -717,13 +801,15 @@ static void convergeephemerons (global_State *g) {
 static void clearbykeys (global_State *g, GCObject *l) {
   for (; l; l = gco2t(l)->gclist) {
     Table *h = gco2t(l);
-    Node *limit = gnodelast(h);
-    Node *n;
-    for (n = gnode(h, 0); n < limit; n++) {
-      if (iscleared(g, gckeyN(n)))  /* unmarked key? */
-        setempty(gval(n));  /* remove entry */
-      if (isempty(gval(n)))  /* is entry empty? */
-        clearkey(n);  /* clear its key */
+    Node *n, *limit;
+    int a;
+    for (a = 0; getnodes(h, a, &n, &limit); a++) {
+      for (; n < limit; n++) {
+        if (iscleared(g, gckeyN(n)))  /* unmarked key? */
+          setempty(gval(n));  /* remove entry */
+        if (isempty(gval(n)))  /* is entry empty? */
+          clearkey(n);  /* clear its key */
+      }
     }
   }
 }
@@ -736,19 +822,29 @@ static void clearbykeys (global_State *g, GCObject *l) {
 static void clearbyvalues (global_State *g, GCObject *l, GCObject *f) {
   for (; l != f; l = gco2t(l)->gclist) {
     Table *h = gco2t(l);
-    Node *n, *limit = gnodelast(h);
+    Node *n, *limit;
+    int a;
     unsigned int i;
-    unsigned int asize = luaH_realasize(h);
+    unsigned int asize = gcasize(h);
     for (i = 0; i < asize; i++) {
       TValue *o = &h->array[i];
       if (iscleared(g, gcvalueN(o)))  /* value was collected? */
         setempty(o);  /* remove entry */
     }
-    for (n = gnode(h, 0); n < limit; n++) {
-      if (iscleared(g, gcvalueN(gval(n))))  /* unmarked value? */
-        setempty(gval(n));  /* remove entry */
-      if (isempty(gval(n)))  /* is entry empty? */
-        clearkey(n);  /* clear its key */
+#if defined(LUAI_SHAPES)
+    for (i = 0; i < cast_uint(nslots(h)); i++) {
+      TValue *o = &h->slots[i];
+      if (iscleared(g, gcvalueN(o)))  /* value was collected? */
+        setempty(o);  /* remove entry */
+    }
+#endif
+    for (a = 0; getnodes(h, a, &n, &limit); a++) {
+      for (; n < limit; n++) {
+        if (iscleared(g, gcvalueN(gval(n))))  /* unmarked value? */
+          setempty(gval(n));  /* remove entry */
+        if (isempty(gval(n)))  /* is entry empty? */
+          clearkey(n);  /* clear its key */
+      }
     }
   }
 }
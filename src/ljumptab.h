@@ -107,6 +107,10 @@ static const void *const disptab[NUM_OPCODES] = {
 &&L_OP_CLOSURE,
 &&L_OP_VARARG,
 &&L_OP_VARARGPREP,
-&&L_OP_EXTRAARG
+&&L_OP_EXTRAARG,
+&&L_OP_MOVECALL,
+&&L_OP_GETUPVALMOVE,
+&&L_OP_GETFIELD2,
+&&L_OP_SETFIELDGET
 
 };
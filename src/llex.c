@@ -136,7 +136,7 @@ TString *luaX_newstring (LexState *ls, const char *str, size_t l) {
   TString *ts = luaS_newlstr(L, str, l);  /* create new string */
   const TValue *o = luaH_getstr(ls->h, ts);
   if (!ttisnil(o))  /* string already present? */
-    ts = keystrval(nodefromval(o));  /* get saved copy */
+    ts = strkeyfromval(ls->h, o);  /* get saved copy */
   else {  /* not in use yet */
     TValue *stv = s2v(L->top++);  /* reserve stack space for string */
     setsvalue(L, stv, ts);  /* temporarily anchor the string */
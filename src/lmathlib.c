@@ -744,12 +744,23 @@ static const luaL_Reg mathlib[] = {
   {NULL, NULL}
 };
 
+/* functions from 'mathlib' that can be called as leaf functions */
+static const luaL_Reg math_leaffuncs[] = {
+  {"abs",   math_abs},
+  {"ceil",  math_ceil},
+  {"tointeger", math_toint},
+  {"floor", math_floor},
+  {"type", math_type},
+  {NULL, NULL}
+};
+
 
 /*
 ** Open math library
 */
 LUAMOD_API int luaopen_math (lua_State *L) {
   luaL_newlib(L, mathlib);
+  luaL_setleaffuncs(L, math_leaffuncs);
   lua_pushnumber(L, PI);
   lua_setfield(L, -2, "pi");
   lua_pushnumber(L, (lua_Number)HUGE_VAL);
@@ -539,6 +539,25 @@ typedef struct AbsLineInfo {
 */
 typedef struct CallInfo *(*AotCompiledFunction) (lua_State *L, struct CallInfo *ci);
 
+/*
+** Speculation guard in AOT code: the instruction it protects and how
+** many times it failed (bailing out to the generic code for that pc)
+*/
+typedef struct AotGuard {
+  int pc;
+  unsigned int failures;
+} AotGuard;
+
+/*
+** Inline cache of a field access in interpreted code: where the
+** instruction last found its key, and how often that was right
+*/
+typedef struct InlineCache {
+  unsigned int idx;  /* position of the key in the node array */
+  unsigned int hits;
+  unsigned int misses;
+} InlineCache;
+
 /*
 ** Function Prototypes
 */
@@ -566,6 +585,13 @@ typedef struct Proto {
   TString  *source;  /* used for debug information */
   GCObject *gclist;
   AotCompiledFunction aot_implementation;
+  AotGuard *aot_guards;  /* speculation guards of the AOT code */
+  int sizeaot_guards;  /* size of 'aot_guards' */
+  InlineCache *icache;  /* parallel to 'code' (created on first call) */
+  struct LClosure *cache;  /* closure reused by AOT code (no local upvalues) */
+#if defined(LUAI_OPCOUNT)
+  lua_Unsigned *opcounts;  /* executions of each instruction (as 'icache') */
+#endif
 } Proto;
 
 /* }================================================================== */
@@ -584,11 +610,14 @@ typedef struct Proto {
 #define LUA_VLCL	makevariant(LUA_TFUNCTION, 0)  /* Lua closure */
 #define LUA_VLCF	makevariant(LUA_TFUNCTION, 1)  /* light C function */
 #define LUA_VCCL	makevariant(LUA_TFUNCTION, 2)  /* C closure */
+#define LUA_VLEAF	makevariant(LUA_TFUNCTION, 3)  /* leaf light C function */
 
 #define ttisfunction(o)		checktype(o, LUA_TFUNCTION)
 #define ttisLclosure(o)		checktag((o), ctb(LUA_VLCL))
 #define ttislcf(o)		checktag((o), LUA_VLCF)
 #define ttisCclosure(o)		checktag((o), ctb(LUA_VCCL))
+#define ttisleaf(o)		checktag((o), LUA_VLEAF)
+#define ttislightcf(o)		(ttislcf(o) || ttisleaf(o))
 #define ttisclosure(o)         (ttisLclosure(o) || ttisCclosure(o))
 
 
@@ -596,7 +625,7 @@ typedef struct Proto {
 
 #define clvalue(o)	check_exp(ttisclosure(o), gco2cl(val_(o).gc))
 #define clLvalue(o)	check_exp(ttisLclosure(o), gco2lcl(val_(o).gc))
-#define fvalue(o)	check_exp(ttislcf(o), val_(o).f)
+#define fvalue(o)	check_exp(ttislightcf(o), val_(o).f)
 #define clCvalue(o)	check_exp(ttisCclosure(o), gco2ccl(val_(o).gc))
 
 #define fvalueraw(v)	((v).f)
@@ -611,6 +640,9 @@ typedef struct Proto {
 #define setfvalue(obj,x) \
   { TValue *io=(obj); val_(io).f=(x); settt_(io, LUA_VLCF); }
 
+#define setleafvalue(obj,x) \
+  { TValue *io=(obj); val_(io).f=(x); settt_(io, LUA_VLEAF); }
+
 #define setclCvalue(L,obj,x) \
   { TValue *io = (obj); CClosure *x_ = (x); \
     val_(io).gc = obj2gco(x_); settt_(io, ctb(LUA_VCCL)); \
@@ -728,16 +760,72 @@ typedef union Node {
 #define setnorealasize(t)	((t)->flags |= BITRAS)
 
 
+/*
+** Typed array parts keep raw 'Value's, which must be as large as both
+** numbers.
+*/
+#if defined(LUAI_TYPEDARRAY) && \
+    (LUA_FLOAT_TYPE != LUA_FLOAT_DOUBLE || LUA_INT_TYPE != LUA_INT_LONGLONG)
+#undef LUAI_TYPEDARRAY
+#endif
+
+
+/* incremental rehashing moves nodes along the chains of the hash part */
+#if defined(LUAI_INCREHASH) && defined(LUAI_SWISSTABLE)
+#undef LUAI_INCREHASH
+#endif
+
+
+#if defined(LUAI_SHAPES)
+/*
+** Shape of a table that keeps its short-string keys in a shared, immutable
+** list (see 'ltable.c'). Tables that get the same keys in the same order
+** share the same shape, and each one keeps only the values, in its
+** 'slots', in the order of the keys.
+*/
+typedef struct Shape {
+  struct Shape *parent;  /* shape without the last key */
+  struct Shape *children;  /* shapes with one more key than this one */
+  struct Shape *sibling;  /* next shape in the list of children of 'parent' */
+  int nrefs;  /* number of tables and children using this shape */
+  lu_byte nchildren;  /* length of list 'children' */
+  lu_byte nkeys;  /* number of keys */
+  struct TString *keys[1];  /* keys, in slot order */
+} Shape;
+#endif
+
+
 typedef struct Table {
   CommonHeader;
   lu_byte flags;  /* 1<<p means tagmethod(p) is not present */
   lu_byte lsizenode;  /* log2 of size of 'node' array */
   unsigned int alimit;  /* "limit" of 'array' array */
+  unsigned int border;  /* last boundary found in the hash part */
+  unsigned int cursor;  /* index of the last entry given by 'luaH_tfornext' */
   TValue *array;  /* array part */
   Node *node;
   Node *lastfree;  /* any free position is before this position */
   struct Table *metatable;
   GCObject *gclist;
+#if defined(LUAI_SWISSTABLE)
+  lu_byte *ctrl;  /* control bytes of the hash part (see 'ltable.c') */
+  int growthleft;  /* number of new keys that still fit in the hash part */
+#endif
+#if defined(LUAI_SHAPES)
+  struct Shape *shape;  /* keys of 'slots', or NULL */
+  TValue *slots;  /* values of the keys in 'shape' */
+  lu_byte sizeslots;  /* size of 'slots' */
+#endif
+#if defined(LUAI_TYPEDARRAY)
+  lu_byte akind;  /* tag of all elements of a typed 'array', or 0 */
+  unsigned int aslotidx;  /* index of the element copied to 'aslot' */
+  TValue aslot;  /* copy of an element of a typed 'array' */
+#endif
+#if defined(LUAI_INCREHASH)
+  lu_byte oldlsizenode;  /* log2 of size of 'oldnode' array */
+  unsigned int nmoved;  /* number of nodes of 'oldnode' already moved */
+  Node *oldnode;  /* previous 'node' array while rehashing, or NULL */
+#endif
 } Table;
 
 
@@ -751,6 +839,7 @@ typedef struct Table {
 #define keyisinteger(node)	(keytt(node) == LUA_VNUMINT)
 #define keyival(node)		(keyval(node).i)
 #define keyisshrstr(node)	(keytt(node) == ctb(LUA_VSHRSTR))
+#define keyislightcf(node)	(keytt(node) == LUA_VLCF || keytt(node) == LUA_VLEAF)
 #define keystrval(node)		(gco2ts(keyval(node).gc))
 
 #define setnilkey(node)		(keytt(node) = LUA_TNIL)
@@ -100,5 +100,9 @@ LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
  ,opmode(0, 1, 0, 0, 1, iABC)		/* OP_VARARG */
  ,opmode(0, 0, 1, 0, 1, iABC)		/* OP_VARARGPREP */
  ,opmode(0, 0, 0, 0, 0, iAx)		/* OP_EXTRAARG */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_MOVECALL */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETUPVALMOVE */
+ ,opmode(0, 0, 0, 0, 1, iABC)		/* OP_GETFIELD2 */
+ ,opmode(0, 0, 0, 0, 0, iABC)		/* OP_SETFIELDGET */
 };
 
@@ -96,6 +96,10 @@ static const char *const opnames[] = {
   "VARARG",
   "VARARGPREP",
   "EXTRAARG",
+  "MOVECALL",
+  "GETUPVALMOVE",
+  "GETFIELD2",
+  "SETFIELDGET",
   NULL
 };
 
@@ -27,6 +27,14 @@
 #define _FILE_OFFSET_BITS       64
 #endif
 
+/*
+** Anonymous mappings and 'madvise', used by LUA_USE_MMAPSTACK, are not
+** part of XSI
+*/
+#if defined(LUA_USE_MMAPSTACK) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #endif				/* } */
 
 
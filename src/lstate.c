@@ -102,59 +102,112 @@ LUA_API int lua_setcstacklimit (lua_State *L, unsigned int limit) {
 }
 
 
+/*
+** Sizes of CallInfo chunks: the first chunk of a thread is small, as
+** most coroutines never go deep, and each new chunk doubles the size
+** of the previous one, up to a maximum.
+*/
+#define CIMINCHUNK	8
+#define CIMAXCHUNK	64
+
+
+/*
+** Add a new chunk of CallInfos to the end of the 'ci' list (which is
+** where 'L->ci' is) and return its first entry.
+*/
 CallInfo *luaE_extendCI (lua_State *L) {
-  CallInfo *ci;
+  CIChunk **last = &L->cichunks;
+  CIChunk *c;
+  int i, n = CIMINCHUNK;
   lua_assert(L->ci->next == NULL);
-  ci = luaM_new(L, CallInfo);
+  while (*last != NULL) {  /* find end of the chunk list */
+    n = (*last)->size * 2;
+    last = &(*last)->next;
+  }
+  if (n > CIMAXCHUNK)
+    n = CIMAXCHUNK;
+  c = cast(CIChunk *, luaM_newobject(L, 0, sizeCIchunk(n)));
   lua_assert(L->ci->next == NULL);
-  L->ci->next = ci;
-  ci->previous = L->ci;
-  ci->next = NULL;
-  ci->u.l.trap = 0;
-  L->nci++;
-  return ci;
+  c->next = NULL;
+  c->size = n;
+  for (i = 0; i < n; i++) {
+    CallInfo *ci = &c->ci[i];
+    ci->previous = (i == 0) ? L->ci : ci - 1;
+    ci->next = (i < n - 1) ? ci + 1 : NULL;
+    ci->u.l.trap = 0;
+  }
+  *last = c;
+  L->ci->next = c->ci;
+  L->nci += n;
+  return c->ci;
 }
 
 
 /*
-** free all CallInfo structures not in use by a thread
+** Return the chunk with 'L->ci', or NULL if it is 'base_ci'. Entries
+** are used in list order, so all chunks after that one are free.
 */
-void luaE_freeCI (lua_State *L) {
-  CallInfo *ci = L->ci;
-  CallInfo *next = ci->next;
-  ci->next = NULL;
-  while ((ci = next) != NULL) {
-    next = ci->next;
-    luaM_free(L, ci);
-    L->nci--;
+static CIChunk *currentchunk (lua_State *L) {
+  CIChunk *c = NULL;
+  CIChunk *next = L->cichunks;
+  int used = L->nci;
+  CallInfo *ci;
+  for (ci = L->ci->next; ci != NULL; ci = ci->next)
+    used--;  /* discount free entries */
+  while (used > 0) {  /* skip chunks with entries in use */
+    c = next;
+    used -= c->size;
+    next = c->next;
   }
+  return c;
 }
 
 
 /*
-** free half of the CallInfo structures not in use by a thread,
-** keeping the first one.
+** free all chunks after chunk 'c' (or all chunks, if 'c' is NULL),
+** ending the 'ci' list at the last entry before them
 */
-void luaE_shrinkCI (lua_State *L) {
-  CallInfo *ci = L->ci->next;  /* first free CallInfo */
-  CallInfo *next;
-  if (ci == NULL)
-    return;  /* no extra elements */
-  while ((next = ci->next) != NULL) {  /* two extra elements? */
-    CallInfo *next2 = next->next;  /* next's next */
-    ci->next = next2;  /* remove next from the list */
-    L->nci--;
-    luaM_free(L, next);  /* free next */
-    if (next2 == NULL)
-      break;  /* no more elements */
-    else {
-      next2->previous = ci;
-      ci = next2;  /* continue */
-    }
+static void freechunksafter (lua_State *L, CIChunk *c) {
+  CIChunk *next;
+  if (c == NULL) {
+    next = L->cichunks;
+    L->cichunks = NULL;
+    L->base_ci.next = NULL;
+  }
+  else {
+    next = c->next;
+    c->next = NULL;
+    c->ci[c->size - 1].next = NULL;
+  }
+  while ((c = next) != NULL) {
+    next = c->next;
+    L->nci -= c->size;
+    luaM_freemem(L, c, sizeCIchunk(c->size));
   }
 }
 
 
+/*
+** free all CallInfo chunks not in use by a thread
+*/
+void luaE_freeCI (lua_State *L) {
+  freechunksafter(L, currentchunk(L));
+}
+
+
+/*
+** free the CallInfo chunks not in use by a thread, keeping the first
+** one, so that a thread whose depth oscillates around the end of a
+** chunk does not keep allocating and freeing it
+*/
+void luaE_shrinkCI (lua_State *L) {
+  CIChunk *c = currentchunk(L);
+  c = (c == NULL) ? L->cichunks : c->next;  /* first free chunk */
+  if (c != NULL)
+    freechunksafter(L, c);
+}
+
+
 /*
 ** Called when 'getCcalls(L)' larger or equal to LUAI_MAXCCALLS.
 ** If equal, raises an overflow error. If value is larger than
@@ -177,18 +230,19 @@ LUAI_FUNC void luaE_incCstack (lua_State *L) {
 }
 
 
-static void stack_init (lua_State *L1, lua_State *L) {
+/*
+** Erase the whole stack of 'L1' and leave only the basic 'ci' on it
+*/
+static void resetstack (lua_State *L1) {
   int i; CallInfo *ci;
-  /* initialize stack array */
-  L1->stack = luaM_newvector(L, BASIC_STACK_SIZE + EXTRA_STACK, StackValue);
   L1->tbclist = L1->stack;
-  for (i = 0; i < BASIC_STACK_SIZE + EXTRA_STACK; i++)
-    setnilvalue(s2v(L1->stack + i));  /* erase new stack */
+  for (i = 0; i < stacksize(L1) + EXTRA_STACK; i++)
+    setnilvalue(s2v(L1->stack + i));  /* erase stack */
   L1->top = L1->stack;
-  L1->stack_last = L1->stack + BASIC_STACK_SIZE;
   /* initialize first ci */
   ci = &L1->base_ci;
-  ci->next = ci->previous = NULL;
+  ci->next = (L1->cichunks != NULL) ? L1->cichunks->ci : NULL;
+  ci->previous = NULL;
   ci->callstatus = CIST_C;
   ci->func = L1->top;
   ci->u.c.k = NULL;
@@ -200,13 +254,21 @@ static void stack_init (lua_State *L1, lua_State *L) {
 }
 
 
+static void stack_init (lua_State *L1, lua_State *L) {
+  /* initialize stack array */
+  L1->stack = luaD_newstack(L, BASIC_STACK_SIZE + EXTRA_STACK);
+  L1->stack_last = L1->stack + BASIC_STACK_SIZE;
+  resetstack(L1);
+}
+
+
 static void freestack (lua_State *L) {
   if (L->stack == NULL)
     return;  /* stack not completely built yet */
   L->ci = &L->base_ci;  /* free the entire 'ci' list */
   luaE_freeCI(L);
   lua_assert(L->nci == 0);
-  luaM_freearray(L, L->stack, stacksize(L) + EXTRA_STACK);  /* free stack */
+  luaD_freestack(L, L->stack, stacksize(L) + EXTRA_STACK);  /* free stack */
 }
 
 
@@ -246,11 +308,11 @@ static void f_luaopen (lua_State *L, void *ud) {
 ** preinitialize a thread with consistent values without allocating
 ** any memory (to avoid errors)
 */
-static void preinit_thread (lua_State *L, global_State *g) {
-  G(L) = g;
-  L->stack = NULL;
-  L->ci = NULL;
-  L->nci = 0;
+/*
+** Set the fields of a thread that do not survive its reuse from
+** 'threadpool'
+*/
+static void resetthreadfields (lua_State *L) {
   L->twups = L;  /* thread has no upvalues */
   L->nCcalls = 0;
   L->errorJmp = NULL;
@@ -266,6 +328,54 @@ static void preinit_thread (lua_State *L, global_State *g) {
 }
 
 
+static void preinit_thread (lua_State *L, global_State *g) {
+  G(L) = g;
+  L->stack = NULL;
+  L->ci = NULL;
+  L->nci = 0;
+  L->cichunks = NULL;
+  resetthreadfields(L);
+}
+
+
+/*
+** Try to keep dead thread 'L1' in 'threadpool', so that 'lua_newthread'
+** can reuse it. Its stack goes back to the basic size (and is erased)
+** and it keeps only its first chunk of CallInfos. Returns 0 if the
+** thread must be freed instead.
+*/
+static int poolthread (lua_State *L, lua_State *L1) {
+  global_State *g = G(L);
+  if (g->nthreadpool >= LUAI_MAXTHREADPOOL || L1->stack == NULL)
+    return 0;
+  L1->ci = &L1->base_ci;
+  L1->base_ci.func = L1->top = L1->tbclist = L1->stack;
+  L1->base_ci.top = L1->stack + 1;
+  luaE_shrinkCI(L1);
+  if (stacksize(L1) != BASIC_STACK_SIZE &&
+      !luaD_reallocstack(L1, BASIC_STACK_SIZE, 0))
+    return 0;
+  resetstack(L1);
+  resetthreadfields(L1);
+  L1->next = g->threadpool;
+  g->threadpool = obj2gco(L1);
+  g->nthreadpool++;
+  return 1;
+}
+
+
+static void freethreadpool (lua_State *L) {
+  global_State *g = G(L);
+  while (g->threadpool != NULL) {
+    lua_State *L1 = gco2th(g->threadpool);
+    g->threadpool = L1->next;
+    freestack(L1);
+    luaM_free(L, fromstate(L1));
+  }
+  g->nthreadpool = 0;
+}
+
+
 static void close_state (lua_State *L) {
   global_State *g = G(L);
   if (!completestate(g))  /* closing a partially built state? */
@@ -275,8 +385,12 @@ static void close_state (lua_State *L) {
     luaC_freeallobjects(L);  /* collect all objects */
     luai_userstateclose(L);
   }
+  freethreadpool(L);
   luaM_freearray(L, G(L)->strt.hash, G(L)->strt.size);
   freestack(L);
+#if defined(LUAI_SHAPES)
+  lua_assert(g->rootshape.children == NULL);
+#endif
   lua_assert(gettotalbytes(g) == sizeof(LG));
   (*g->frealloc)(g->ud, fromstate(L), sizeof(LG), 0);  /* free main block */
 }
@@ -285,11 +399,18 @@ static void close_state (lua_State *L) {
 LUA_API lua_State *lua_newthread (lua_State *L) {
   global_State *g;
   lua_State *L1;
+  int reused;
   lua_lock(L);
   g = G(L);
   luaC_checkGC(L);
-  /* create new thread */
-  L1 = &cast(LX *, luaM_newobject(L, LUA_TTHREAD, sizeof(LX)))->l;
+  reused = (g->threadpool != NULL);
+  if (reused) {  /* reuse a dead thread? */
+    L1 = gco2th(g->threadpool);
+    g->threadpool = L1->next;
+    g->nthreadpool--;
+  }
+  else  /* create new thread */
+    L1 = &cast(LX *, luaM_newobject(L, LUA_TTHREAD, sizeof(LX)))->l;
   L1->marked = luaC_white(g);
   L1->tt = LUA_VTHREAD;
   /* link it on list 'allgc' */
@@ -298,7 +419,8 @@ LUA_API lua_State *lua_newthread (lua_State *L) {
   /* anchor it on L stack */
   setthvalue2s(L, L->top, L1);
   api_incr_top(L);
-  preinit_thread(L1, g);
+  if (!reused)
+    preinit_thread(L1, g);
   L1->hookmask = L->hookmask;
   L1->basehookcount = L->basehookcount;
   L1->hook = L->hook;
@@ -307,7 +429,8 @@ LUA_API lua_State *lua_newthread (lua_State *L) {
   memcpy(lua_getextraspace(L1), lua_getextraspace(g->mainthread),
          LUA_EXTRASPACE);
   luai_userstatethread(L, L1);
-  stack_init(L1, L);  /* init stack */
+  if (!reused)
+    stack_init(L1, L);  /* init stack */
   lua_unlock(L);
   return L1;
 }
@@ -318,8 +441,10 @@ void luaE_freethread (lua_State *L, lua_State *L1) {
   luaF_closeupval(L1, L1->stack);  /* close all upvalues */
   lua_assert(L1->openupval == NULL);
   luai_userstatefree(L, L1);
-  freestack(L1);
-  luaM_free(L, l);
+  if (!poolthread(L, L1)) {
+    freestack(L1);
+    luaM_free(L, l);
+  }
 }
 
 
@@ -337,7 +462,8 @@ int luaE_resetthread (lua_State *L, int status) {
     L->top = L->stack + 1;
   ci->top = L->top + LUA_MINSTACK;
   L->status = cast_byte(status);
-  luaD_reallocstack(L, cast_int(ci->top - L->stack), 0);
+  if (stacksize(L) > BASIC_STACK_SIZE)  /* keep a basic stack for reuse */
+    luaD_reallocstack(L, BASIC_STACK_SIZE, 0);
   return status;
 }
 
@@ -371,6 +497,14 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->warnf = NULL;
   g->ud_warn = NULL;
   g->mainthread = L;
+  g->threadpool = NULL;
+  g->nthreadpool = 0;
+  for (i = 0; i < LUA_NUMVMF; i++) g->vmfuncs[i] = NULL;
+#if defined(LUAI_SHAPES)
+  g->rootshape.parent = g->rootshape.children = g->rootshape.sibling = NULL;
+  g->rootshape.nrefs = 1;  /* never released */
+  g->rootshape.nchildren = g->rootshape.nkeys = 0;
+#endif
   g->seed = luai_makeseed(L);
   g->gcrunning = 0;  /* no GC while building state */
   g->strt.size = g->strt.nuse = 0;
@@ -380,6 +514,13 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->gcstate = GCSpause;
   g->gckind = KGC_INC;
   g->gcstopem = 0;
+  g->lensearches = 0;
+#if defined(LUAI_LENSTATS)
+  g->lencount = 0;
+#endif
+#if defined(LUAI_OPCOUNT)
+  memset(&g->opstats, 0, sizeof(g->opstats));
+#endif
   g->gcemergency = 0;
   g->finobj = g->tobefnz = g->fixedgc = NULL;
   g->firstold1 = g->survival = g->old1 = g->reallyold = NULL;
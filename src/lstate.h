@@ -142,6 +142,15 @@ struct lua_longjmp;  /* defined in ldo.c */
 #define stacksize(th)	cast_int((th)->stack_last - (th)->stack)
 
 
+/*
+** Maximum number of dead threads kept in 'threadpool', to be reused by
+** 'lua_newthread' instead of allocating a new state and a new stack
+*/
+#if !defined(LUAI_MAXTHREADPOOL)
+#define LUAI_MAXTHREADPOOL	64
+#endif
+
+
 /* kinds of Garbage Collection */
 #define KGC_INC		0	/* incremental gc */
 #define KGC_GEN		1	/* generational gc */
@@ -178,6 +187,7 @@ typedef struct CallInfo {
       const Instruction *savedpc;
       volatile l_signalT trap;
       int nextraargs;  /* # of extra arguments in vararg functions */
+      int delta;  /* how far VARARGPREP moved 'func' (vararg functions) */
     } l;
     struct {  /* only for C functions */
       lua_KFunction k;  /* continuation in case of yields */
@@ -199,6 +209,20 @@ typedef struct CallInfo {
 } CallInfo;
 
 
+/*
+** The CallInfos after 'base_ci' live in chunks of consecutive entries,
+** linked in the same order as the 'ci' list, so that a thread allocates
+** (and frees) them a chunk at a time.
+*/
+typedef struct CIChunk {
+  struct CIChunk *next;  /* chunk with the following entries */
+  int size;  /* number of entries in 'ci' */
+  CallInfo ci[1];
+} CIChunk;
+
+#define sizeCIchunk(n)	(offsetof(CIChunk, ci) + sizeof(CallInfo) * (n))
+
+
 /*
 ** Bits in CallInfo status
 */
@@ -243,6 +267,22 @@ typedef struct CallInfo {
 #define getoah(st)	((st) & CIST_OAH)
 
 
+#if defined(LUAI_OPCOUNT)
+
+#include "lopcodes.h"
+
+/*
+** Execution counters of the interpreter (see 'lua_opstats')
+*/
+typedef struct OpStats {
+  lua_Unsigned ops[NUM_OPCODES];  /* executions of each opcode */
+  lua_Unsigned pairs[NUM_OPCODES][NUM_OPCODES];  /* of each opcode pair */
+  OpCode last;  /* last opcode executed */
+} OpStats;
+
+#endif
+
+
 /*
 ** 'global state', shared by all threads of this state
 */
@@ -289,12 +329,25 @@ typedef struct global_State {
   struct lua_State *twups;  /* list of threads with open upvalues */
   lua_CFunction panic;  /* to be called in unprotected errors */
   struct lua_State *mainthread;
+  GCObject *threadpool;  /* list of dead threads ready for reuse */
+  int nthreadpool;  /* number of threads in 'threadpool' */
   TString *memerrmsg;  /* message for memory-allocation errors */
   TString *tmname[TM_N];  /* array with tag-method names */
   struct Table *mt[LUA_NUMTAGS];  /* metatables for basic types */
   TString *strcache[STRCACHE_N][STRCACHE_M];  /* cache for strings in API */
   lua_WarnFunction warnf;  /* warning function */
   void *ud_warn;         /* auxiliary data to 'warnf' */
+  lua_CFunction vmfuncs[LUA_NUMVMF];  /* see 'lua_setvmfunction' */
+#if defined(LUAI_LENSTATS)
+  lua_Unsigned lencount;  /* number of table lengths (see 'luaH_getn') */
+#endif
+  lua_Unsigned lensearches;  /* lengths that had to search for a border */
+#if defined(LUAI_SHAPES)
+  Shape rootshape;  /* shape without keys, parent of all other shapes */
+#endif
+#if defined(LUAI_OPCOUNT)
+  OpStats opstats;  /* (last, so that its size does not move other fields) */
+#endif
 } global_State;
 
 
@@ -317,6 +370,7 @@ struct lua_State {
   struct lua_State *twups;  /* list of threads with open upvalues */
   struct lua_longjmp *errorJmp;  /* current error recover point */
   CallInfo base_ci;  /* CallInfo for first level (C calling Lua) */
+  CIChunk *cichunks;  /* chunks with the rest of the 'ci' list */
   volatile lua_Hook hook;
   ptrdiff_t errfunc;  /* current error handling function (stack index) */
   l_uint32 nCcalls;  /* number of nested (non-yieldable | C)  calls */
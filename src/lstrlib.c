@@ -1792,6 +1792,14 @@ static const luaL_Reg strlib[] = {
 };
 
 
+/* functions from 'strlib' that can be called as leaf functions */
+static const luaL_Reg str_leaffuncs[] = {
+  {"byte", str_byte},
+  {"len", str_len},
+  {NULL, NULL}
+};
+
+
 static void createmetatable (lua_State *L) {
   /* table to be metatable for strings */
   luaL_newlibtable(L, stringmetamethods);
@@ -1811,6 +1819,7 @@ static void createmetatable (lua_State *L) {
 */
 LUAMOD_API int luaopen_string (lua_State *L) {
   luaL_newlib(L, strlib);
+  luaL_setleaffuncs(L, str_leaffuncs);
   createmetatable(L);
   return 1;
 }
@@ -21,10 +21,22 @@
 ** in its main position (i.e. the 'original' position that its hash gives
 ** to it), then the colliding element is in its own main position.
 ** Hence even when the load factor reaches 100%, performance remains good.
+** With LUAI_INCREHASH, a large hash part grows incrementally (see
+** 'startrehash').
+** With LUAI_SWISSTABLE, the hash part is an open-addressing table
+** instead (see section 'Swiss tables').
+** With LUAI_SHAPES, tables whose keys outside the array part are all
+** short strings keep them in shared shapes instead of a hash part (see
+** section 'Shapes').
 */
 
 #include <math.h>
 #include <limits.h>
+#include <string.h>
+
+#if defined(LUAI_SWISSTABLE) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "lua.h"
 
@@ -84,7 +96,7 @@
 #define hashstr(t,str)		hashpow2(t, (str)->hash)
 #define hashboolean(t,p)	hashpow2(t, p)
 
-#define hashint(t,i)		hashpow2(t, i)
+#define hashint(t,i)	gnode(t, fibhash(foldint(l_castS2U(i)), (t)->lsizenode))
 
 
 #define hashpointer(t,p)	hashmod(t, point2uint(p))
@@ -103,35 +115,232 @@ static const TValue absentkey = {ABSTKEYCONSTANT};
 
 
 /*
-** Hash for floating-point numbers.
-** The main computation should be just
-**     n = frexp(n, &i); return (n * INT_MAX) + i
-** but there are some numerical subtleties.
-** In a two-complement representation, INT_MAX does not has an exact
-** representation as a float, but INT_MIN does; because the absolute
-** value of 'frexp' is smaller than 1 (unless 'n' is inf/NaN), the
-** absolute value of the product 'frexp * -INT_MIN' is smaller or equal
-** to INT_MAX. Next, the use of 'unsigned int' avoids overflows when
-** adding 'i'; the use of '~u' (instead of '-u') avoids problems with
-** INT_MIN.
+** Hash for floating-point numbers, to be mixed by 'mixhash'.
+** 'frexp' splits 'n' into a fraction 'f', with absolute value in
+** [0.5, 1), and an exponent 'e'. The hash combines 'e' with the first
+** 31 bits of 'f' ('f * 2^31', rounded down) and with its next 31 bits,
+** so that it depends on all the 53 bits of a double (a hash with only
+** the first bits would give the same value to timestamps that differ
+** in milliseconds). These products are exact, and their integer parts
+** fit in an 'int' (as INT_MIN is -2^31).
 */
 #if !defined(l_hashfloat)
-static int l_hashfloat (lua_Number n) {
-  int i;
-  lua_Integer ni;
-  n = l_mathop(frexp)(n, &i) * -cast_num(INT_MIN);
-  if (!lua_numbertointeger(n, &ni)) {  /* is 'n' inf/-inf/NaN? */
+static unsigned int l_hashfloat (lua_Number n) {
+  int e;
+  lua_Number hi, lo;
+  n = l_mathop(frexp)(n, &e) * -cast_num(INT_MIN);
+  if (!(l_mathop(fabs)(n) < -cast_num(INT_MIN))) {  /* inf/-inf/NaN? */
     lua_assert(luai_numisnan(n) || l_mathop(fabs)(n) == cast_num(HUGE_VAL));
     return 0;
   }
-  else {  /* normal case */
-    unsigned int u = cast_uint(i) + cast_uint(ni);
-    return cast_int(u <= cast_uint(INT_MAX) ? u : ~u);
-  }
+  hi = l_mathop(floor)(n);
+  lo = (n - hi) * -cast_num(INT_MIN);
+  return (cast_uint(cast_int(hi)) ^ (cast_uint(cast_int(lo)) * 0x9e3779b9u))
+         + cast_uint(e);
+}
+#endif
+
+
+/*
+** Mix the bits of 'h', so that both its low bits (the position) and
+** its high bits (the tag of Swiss tables) depend on all of them. (This
+** is the final mix of MurmurHash3.)
+*/
+static unsigned int mixhash (unsigned int h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+
+/* fold the high half of a 64-bit integer into its low half */
+#define foldint(u)	cast_uint((u) ^ (((u) >> 31) >> 1))
+
+
+#if defined(LUAI_SWISSTABLE)
+
+/*
+** {==================================================================
+** Swiss tables
+** ===================================================================
+** The hash part is an open-addressing table. Besides 'node', it has an
+** array 'ctrl' with one control byte per node: CTRLEMPTY for a free
+** node, or the 7 high bits of the key's hash (its tag) for a used one.
+** A search loads the control bytes of a group of GROUPSIZE consecutive
+** nodes, starting at the node given by the low bits of the hash, and
+** compares them all at once with the tag of the key; only the nodes
+** whose tags match have their keys compared. If the group has a free
+** node, the key is not in the table. Otherwise, the search goes on to
+** other groups, with triangular probing, which visits all groups.
+** So that a group can start at any node, 'ctrl' has GROUPSIZE - 1
+** extra bytes after its 'sizenode' entries, each one a copy of the
+** entry at its index modulo 'sizenode'.
+** As in the chained version, keys are never removed: a key with a nil
+** value keeps its node until the next rehash, so there are no
+** tombstones. The table is rehashed when the number of used nodes
+** would go over 7/8 of its size; 'growthleft' counts how many more keys
+** fit until then.
+** ===================================================================
+*/
+
+#define GROUPSIZE	16
+
+#define CTRLEMPTY	0x80
+
+/* number of control bytes of a hash part with 'n' nodes */
+#define sizectrl(n)	((n) + GROUPSIZE - 1)
+
+/* size of the block with 'n' nodes followed by their control bytes */
+#define sizehashpart(n)	(cast_sizet(n) * sizeof(Node) + sizectrl(n))
+
+/* maximum number of used nodes in a hash part with 'n' nodes */
+#define maxgrowth(n)	((n) - (n) / 8)
+
+/* tag of a hash in the control bytes */
+#define ctrltag(h)	cast_byte((h) >> 25)
+
+
+/* control bytes of 'dummynode' */
+static const lu_byte dummyctrl[GROUPSIZE] = {
+  CTRLEMPTY, CTRLEMPTY, CTRLEMPTY, CTRLEMPTY,
+  CTRLEMPTY, CTRLEMPTY, CTRLEMPTY, CTRLEMPTY,
+  CTRLEMPTY, CTRLEMPTY, CTRLEMPTY, CTRLEMPTY,
+  CTRLEMPTY, CTRLEMPTY, CTRLEMPTY, CTRLEMPTY
+};
+
+
+#if defined(__SSE2__)
+
+/* bit mask of the control bytes in group 'g' equal to 'b' */
+static unsigned int matchbyte (const lu_byte *g, lu_byte b) {
+  __m128i c = _mm_loadu_si128(cast(const __m128i *, g));
+  return cast_uint(_mm_movemask_epi8(_mm_cmpeq_epi8(c,
+                                     _mm_set1_epi8(cast(char, b)))));
+}
+
+/* bit mask of the free nodes in group 'g' */
+static unsigned int matchempty (const lu_byte *g) {
+  __m128i c = _mm_loadu_si128(cast(const __m128i *, g));
+  return cast_uint(_mm_movemask_epi8(c));
+}
+
+#else
+
+static unsigned int matchbyte (const lu_byte *g, lu_byte b) {
+  unsigned int m = 0;
+  int i;
+  for (i = 0; i < GROUPSIZE; i++)
+    m |= cast_uint(g[i] == b) << i;
+  return m;
+}
+
+static unsigned int matchempty (const lu_byte *g) {
+  return matchbyte(g, CTRLEMPTY);
+}
+
+#endif
+
+
+/* index of the lowest bit set in a non-zero mask */
+#if defined(__GNUC__)
+#define lowbit(m)	__builtin_ctz(m)
+#else
+static int lowbit (unsigned int m) {
+  int i = 0;
+  while (!(m & 1u)) { m >>= 1; i++; }
+  return i;
 }
 #endif
 
 
+/*
+** Hash of a key given broken into tag and value, as for 'mainposition'.
+** Strings already have well distributed hashes.
+*/
+static unsigned int hashkey (int ktt, const Value *kvl) {
+  switch (withvariant(ktt)) {
+    case LUA_VNUMINT:
+      return mixhash(foldint(l_castS2U(ivalueraw(*kvl))));
+    case LUA_VNUMFLT:
+      return mixhash(l_hashfloat(fltvalueraw(*kvl)));
+    case LUA_VSHRSTR:
+      return tsvalueraw(*kvl)->hash;
+    case LUA_VLNGSTR:
+      return luaS_hashlongstr(tsvalueraw(*kvl));
+    case LUA_VFALSE:
+      return 0;
+    case LUA_VTRUE:
+      return 1;
+    case LUA_VLIGHTUSERDATA:
+      return mixhash(point2uint(pvalueraw(*kvl)));
+    case LUA_VLCF: case LUA_VLEAF:
+      return mixhash(point2uint(fvalueraw(*kvl)));
+    default:
+      return mixhash(point2uint(gcvalueraw(*kvl)));
+  }
+}
+
+
+#define hashkeyTV(key)	hashkey(rawtt(key), valraw(key))
+
+
+/*
+** Set the control byte of node 'i' to 'b', together with its copies
+** after the end of the array.
+*/
+static void setctrl (Table *t, unsigned int i, lu_byte b) {
+  unsigned int size = sizenode(t);
+  t->ctrl[i] = b;
+  for (i += size; i < sizectrl(size); i += size)
+    t->ctrl[i] = b;
+}
+
+
+/*
+** Take a free node for a new key with hash 'h': the first free node in
+** its probe sequence. The caller ensures that the table has room for
+** the key.
+*/
+static Node *getfreepos (Table *t, unsigned int h) {
+  unsigned int mask = sizenode(t) - 1;
+  unsigned int pos = h & mask;
+  unsigned int step = 0;
+  unsigned int m;
+  lua_assert(t->growthleft > 0);
+  while ((m = matchempty(t->ctrl + pos)) == 0) {  /* group is full? */
+    step += GROUPSIZE;
+    pos = (pos + step) & mask;
+  }
+  pos = (pos + lowbit(m)) & mask;
+  setctrl(t, pos, ctrltag(h));
+  t->growthleft--;
+  return gnode(t, pos);
+}
+
+/* }================================================================== */
+
+#else
+
+
+/*
+** Fibonacci hashing, for integer keys: the position in a hash part of
+** size 2^lsize is given by the high bits of 'h' times 2^32 divided by
+** the golden ratio. (The low bits of this product depend only on the
+** low bits of 'h', but its high bits depend on all of them.) So, keys
+** with a common stride, such as multiples of a power of 2, do not go
+** all to the same nodes, and sequential keys still are spread evenly.
+** The first shift spreads the high bits of 'h' over its low bits, which
+** helps keys that differ only in their high bits.
+*/
+static unsigned int fibhash (unsigned int h, int lsize) {
+  h ^= h >> 16;
+  return ((h * 0x9e3779b9u) >> (31 - lsize)) >> 1;
+}
+
+
 /*
 ** returns the 'main' position of an element in a table (that is,
 ** the index of its hash value). The key comes broken (tag in 'ktt'
@@ -146,7 +355,7 @@ static Node *mainposition (const Table *t, int ktt, const Value *kvl) {
     }
     case LUA_VNUMFLT: {
       lua_Number n = fltvalueraw(*kvl);
-      return hashmod(t, l_hashfloat(n));
+      return hashpow2(t, mixhash(l_hashfloat(n)));
     }
     case LUA_VSHRSTR: {
       TString *ts = tsvalueraw(*kvl);
@@ -164,7 +373,7 @@ static Node *mainposition (const Table *t, int ktt, const Value *kvl) {
       void *p = pvalueraw(*kvl);
       return hashpointer(t, p);
     }
-    case LUA_VLCF: {
+    case LUA_VLCF: case LUA_VLEAF: {
       lua_CFunction f = fvalueraw(*kvl);
       return hashpointer(t, f);
     }
@@ -183,6 +392,8 @@ static Node *mainpositionTV (const Table *t, const TValue *key) {
   return mainposition(t, rawtt(key), valraw(key));
 }
 
+#endif
+
 
 /*
 ** Check whether key 'k1' is equal to the key in node 'n2'. This
@@ -206,8 +417,11 @@ static Node *mainpositionTV (const Table *t, const TValue *key) {
 */
 static int equalkey (const TValue *k1, const Node *n2, int deadok) {
   if ((rawtt(k1) != keytt(n2)) &&  /* not the same variants? */
-       !(deadok && keyisdead(n2) && iscollectable(k1)))
-   return 0;  /* cannot be same key */
+       !(deadok && keyisdead(n2) && iscollectable(k1))) {
+    /* leaf and plain light C functions are the same key */
+    return (ttislightcf(k1) && keyislightcf(n2) &&
+            fvalue(k1) == fvalueraw(keyval(n2)));
+  }
   switch (keytt(n2)) {
     case LUA_VNIL: case LUA_VFALSE: case LUA_VTRUE:
       return 1;
@@ -217,7 +431,7 @@ static int equalkey (const TValue *k1, const Node *n2, int deadok) {
       return luai_numeq(fltvalue(k1), fltvalueraw(keyval(n2)));
     case LUA_VLIGHTUSERDATA:
       return pvalue(k1) == pvalueraw(keyval(n2));
-    case LUA_VLCF:
+    case LUA_VLCF: case LUA_VLEAF:
       return fvalue(k1) == fvalueraw(keyval(n2));
     case ctb(LUA_VLNGSTR):
       return luaS_eqlngstr(tsvalue(k1), keystrval(n2));
@@ -285,6 +499,29 @@ static unsigned int setlimittosize (Table *t) {
 ** which may be in array part, nor for floats with integral values.)
 ** See explanation about 'deadok' in function 'equalkey'.
 */
+#if defined(LUAI_SWISSTABLE)
+
+static const TValue *getgeneric (Table *t, const TValue *key, int deadok) {
+  unsigned int mask = sizenode(t) - 1;
+  unsigned int h = hashkeyTV(key);
+  unsigned int pos = h & mask;
+  unsigned int step = 0;
+  for (;;) {  /* check whether 'key' is somewhere in its probe sequence */
+    const lu_byte *g = t->ctrl + pos;
+    unsigned int m;
+    for (m = matchbyte(g, ctrltag(h)); m != 0; m &= m - 1) {
+      Node *n = gnode(t, (pos + lowbit(m)) & mask);
+      if (equalkey(key, n, deadok))
+        return gval(n);  /* that's it */
+    }
+    if (matchempty(g) != 0 || (step += GROUPSIZE) > mask)
+      return &absentkey;  /* not found */
+    pos = (pos + step) & mask;
+  }
+}
+
+#else
+
 static const TValue *getgeneric (Table *t, const TValue *key, int deadok) {
   Node *n = mainpositionTV(t, key);
   for (;;) {  /* check whether 'key' is somewhere in the chain */
@@ -299,6 +536,41 @@ static const TValue *getgeneric (Table *t, const TValue *key, int deadok) {
   }
 }
 
+#endif
+
+
+#if defined(LUAI_INCREHASH)
+
+/*
+** Search 'key' in the old node array of 't', which is rehashing. A node
+** there that is empty (which includes all nodes already moved) is absent
+** for a lookup, so that a new value for its key goes to the new array,
+** but it still counts for a traversal, when 'deadok' is true.
+*/
+static const TValue *getold (Table *t, const TValue *key, int deadok) {
+  Table ot;  /* a table whose hash part is the old node array */
+  const TValue *slot;
+  ot.node = t->oldnode;
+  ot.lsizenode = t->oldlsizenode;
+  slot = getgeneric(&ot, key, deadok);
+  return (isempty(slot) && !deadok) ? &absentkey : slot;
+}
+
+
+/* search 'key' in the hash part of 't', including its old node array */
+static const TValue *gethash (Table *t, const TValue *key) {
+  const TValue *slot = getgeneric(t, key, 0);
+  if (isabstkey(slot) && isrehashing(t))
+    slot = getold(t, key, 0);
+  return slot;
+}
+
+#else
+
+#define gethash(t,key)		getgeneric(t, key, 0)
+
+#endif
+
 
 /*
 ** returns the index for 'k' if 'k' is an appropriate key to live in
@@ -312,54 +584,371 @@ static unsigned int arrayindex (lua_Integer k) {
 }
 
 
+#if defined(LUAI_SHAPES)
+
+/*
+** {==================================================================
+** Shapes
+** ===================================================================
+** A table without a hash part that gets a short-string key starts using
+** shapes: its keys go to its shape, which is shared by all tables that
+** got the same keys in the same order, and their values go to 'slots',
+** in the order of the keys. Adding a key moves the table to a child of
+** its shape. Shapes form a tree, rooted at 'rootshape' (which has no
+** keys), and are freed when no table or child uses them. A key whose
+** value becomes nil keeps its slot, like dead keys in the hash part.
+** While a table has a shape its hash part is empty. When it gets a key
+** that does not fit (a key of another type, more than MAXSHAPEKEYS keys
+** or a shape with too many children), 'unshape' moves all its fields to
+** an ordinary hash part, and the table does not use shapes any more.
+** As keys are immutable, caches of field accesses can check a slot by
+** comparing the key of the shape at that slot with their key.
+** ===================================================================
+*/
+
+/* maximum number of keys in a shape */
+#define MAXSHAPEKEYS	16
+
+/* maximum number of children of a shape */
+#define MAXSHAPECHILDREN	32
+
+/* size of a shape with 'n' keys */
+#define sizeshape(n)	(offsetof(Shape, keys) + cast_sizet(n) * sizeof(TString *))
+
+/* number of slots in use by table 't' */
+#define nslots(t)	((t)->shape != NULL ? (t)->shape->nkeys : 0)
+
+
+/* slot of 'key' in shape 's', or -1 if it is not there */
+static int shapeslot (const Shape *s, const TString *key) {
+  int i;
+  for (i = 0; i < s->nkeys; i++) {
+    if (s->keys[i] == key)
+      return i;
+  }
+  return -1;
+}
+
+
+/*
+** Release a reference to shape 's', freeing it (and then releasing its
+** parent) if it was the last one. ('rootshape' always keeps a reference.)
+*/
+static void releaseshape (lua_State *L, Shape *s) {
+  while (--s->nrefs == 0) {
+    Shape *p = s->parent;
+    Shape **l = &p->children;
+    while (*l != s)  /* find 's' in the children of its parent */
+      l = &(*l)->sibling;
+    *l = s->sibling;  /* unlink it */
+    p->nchildren--;
+    luaM_freemem(L, s, sizeshape(s->nkeys));
+    s = p;
+  }
+}
+
+
+/*
+** Find the child of shape 's' that adds 'key', moving it to the front of
+** the list of children, as tables built the same way come in bursts.
+*/
+static Shape *findchild (Shape *s, const TString *key) {
+  Shape **l;
+  Shape *c;
+  for (l = &s->children; (c = *l) != NULL; l = &c->sibling) {
+    if (c->keys[s->nkeys] == key) {
+      *l = c->sibling;
+      c->sibling = s->children;
+      s->children = c;
+      return c;
+    }
+  }
+  return NULL;
+}
+
+
+static Shape *newchild (lua_State *L, Shape *s, TString *key) {
+  Shape *c = cast(Shape *, luaM_malloc_(L, sizeshape(s->nkeys + 1), 0));
+  c->parent = s;
+  s->nrefs++;  /* 'c' uses its parent */
+  c->children = NULL;
+  c->nrefs = 0;
+  c->nchildren = 0;
+  c->nkeys = s->nkeys + 1;
+  if (s->nkeys > 0)
+    memcpy(c->keys, s->keys, s->nkeys * sizeof(TString *));
+  c->keys[s->nkeys] = key;
+  c->sibling = s->children;
+  s->children = c;
+  s->nchildren++;
+  return c;
+}
+
+
+/* change the size of the slots of 't' to 'size' */
+static void resizeslots (lua_State *L, Table *t, int size) {
+  int i;
+  TValue *slots = luaM_reallocvector(L, t->slots, t->sizeslots, size, TValue);
+  if (l_unlikely(slots == NULL && size > 0))
+    luaM_error(L);
+  for (i = t->sizeslots; i < size; i++)
+    setempty(&slots[i]);
+  t->slots = slots;
+  t->sizeslots = cast_byte(size);
+}
+
+
+/* set the shape of 't' to 's', releasing its previous shape */
+static void setshape (lua_State *L, Table *t, Shape *s) {
+  Shape *old = t->shape;
+  s->nrefs++;
+  t->shape = s;
+  if (old != NULL)
+    releaseshape(L, old);
+}
+
+
+/*
+** Add short-string 'key', with 'value', to the shape of 't', which has
+** no hash part; a table without a shape starts with 'rootshape'.
+** Returns 0 if the key does not fit in the shape, and then the caller
+** must move the fields of 't' to an ordinary hash part with 'unshape'.
+*/
+static int shapenewkey (lua_State *L, Table *t, TString *key,
+                                                TValue *value) {
+  Shape *s, *c;
+  int n;
+  if (t->shape == NULL)
+    setshape(L, t, &G(L)->rootshape);
+  s = t->shape;
+  n = s->nkeys;
+  if (n >= MAXSHAPEKEYS)
+    return 0;
+  c = findchild(s, key);
+  if (c == NULL && s->nchildren >= MAXSHAPECHILDREN)
+    return 0;
+  if (n >= t->sizeslots)  /* no free slot? */
+    resizeslots(L, t, (n < 2) ? 4 : (n * 2 < MAXSHAPEKEYS) ? n * 2
+                                                            : MAXSHAPEKEYS);
+  if (c == NULL)
+    c = newchild(L, s, key);
+  setshape(L, t, c);
+  setobj2t(L, &t->slots[n], value);
+  return 1;
+}
+
+
+/* get the slot of short-string 'key' in table 't', which has a shape */
+static const TValue *getshapefield (Table *t, TString *key) {
+  int i = shapeslot(t->shape, key);
+  return (i >= 0) ? &t->slots[i] : &absentkey;
+}
+
+
+/* free the shape and slots of 't', if it has them */
+static void freeshape (lua_State *L, Table *t) {
+  if (t->shape != NULL)
+    releaseshape(L, t->shape);
+  luaM_freearray(L, t->slots, t->sizeslots);
+}
+
+/* }================================================================== */
+
+#else
+
+#define nslots(t)	0
+
+#endif
+
+
 /*
 ** returns the index of a 'key' for table traversals. First goes all
 ** elements in the array part, then elements in the hash part. The
-** beginning of a traversal is signaled by 0.
+** beginning of a traversal is signaled by 0, and a key that is not in
+** the table by NOKEYINDEX.
+** (With shapes, the slots go between the array and the hash parts.)
 */
-static unsigned int findindex (lua_State *L, Table *t, TValue *key,
-                               unsigned int asize) {
+#define NOKEYINDEX	(~0u)
+
+static unsigned int keyindex (Table *t, TValue *key, unsigned int asize) {
   unsigned int i;
   if (ttisnil(key)) return 0;  /* first iteration */
   i = ttisinteger(key) ? arrayindex(ivalue(key)) : 0;
   if (i - 1u < asize)  /* is 'key' inside array part? */
     return i;  /* yes; that's the index */
   else {
-    const TValue *n = getgeneric(t, key, 1);
+    const TValue *n;
+#if defined(LUAI_SHAPES)
+    if (t->shape != NULL && ttisshrstring(key)) {
+      int slot = shapeslot(t->shape, tsvalue(key));
+      if (slot >= 0)  /* key is in a slot? */
+        return (slot + 1) + asize;
+    }
+#endif
+    n = getgeneric(t, key, 1);
+#if defined(LUAI_INCREHASH)
+    if (isabstkey(n) && isrehashing(t)) {  /* try the old node array */
+      n = getold(t, key, 1);
+      if (!isabstkey(n)) {
+        i = cast_int(nodefromval(n) - t->oldnode);
+        /* old nodes are numbered after the new ones */
+        return (i + 1) + asize + nslots(t) + sizenode(t);
+      }
+    }
+#endif
     if (l_unlikely(isabstkey(n)))
-      luaG_runerror(L, "invalid key to 'next'");  /* key not found */
+      return NOKEYINDEX;  /* key not found */
     i = cast_int(nodefromval(n) - gnode(t, 0));  /* key index in hash table */
-    /* hash elements are numbered after array ones */
-    return (i + 1) + asize;
+    /* hash elements are numbered after array ones (and slots) */
+    return (i + 1) + asize + nslots(t);
   }
 }
 
 
-int luaH_next (lua_State *L, Table *t, StkId key) {
-  unsigned int asize = luaH_realasize(t);
-  unsigned int i = findindex(L, t, s2v(key), asize);  /* find original key */
+static unsigned int findindex (lua_State *L, Table *t, TValue *key,
+                               unsigned int asize) {
+  unsigned int i = keyindex(t, key, asize);
+  if (l_unlikely(i == NOKEYINDEX))
+    luaG_runerror(L, "invalid key to 'next'");  /* key not found */
+  return i;
+}
+
+
+/*
+** Is 'key' the key of the entry with index 'i' (as given by 'keyindex')
+** in table 't'? (If so, 'keyindex' would return 'i' for it.)
+*/
+static int iskeyat (Table *t, const TValue *key, unsigned int asize,
+                                                 unsigned int i) {
+  if (i - 1u < asize)  /* array part? */
+    return (ttisinteger(key) && l_castS2U(ivalue(key)) == i);
+  i -= asize + 1;
+#if defined(LUAI_SHAPES)
+  if (i < cast_uint(nslots(t)))
+    return (ttisshrstring(key) && t->shape->keys[i] == tsvalue(key));
+  i -= nslots(t);
+#endif
+  if (i < cast_uint(sizenode(t)))
+    return equalkey(key, gnode(t, i), 1);
+#if defined(LUAI_INCREHASH)
+  i -= sizenode(t);
+  if (isrehashing(t) && i < cast_uint(sizeoldnode(t)))
+    return equalkey(key, t->oldnode + i, 1);
+#endif
+  return 0;
+}
+
+
+/*
+** Put at 'key' and 'key + 1' the key and the value of the first
+** non-empty entry of table 't' with an index (as given by 'keyindex')
+** larger than 'i', and return that index. Return 0 if there is none.
+*/
+static unsigned int nextentry (lua_State *L, Table *t, StkId key,
+                               unsigned int asize, unsigned int i) {
+  unsigned int base;
   for (; i < asize; i++) {  /* try first array part */
-    if (!isempty(&t->array[i])) {  /* a non-empty entry? */
+    const TValue *v = arrayslot(t, i);
+    if (!isempty(v)) {  /* a non-empty entry? */
       setivalue(s2v(key), i + 1);
-      setobj2s(L, key + 1, &t->array[i]);
-      return 1;
+      setobj2s(L, key + 1, v);
+      return i + 1;
+    }
+  }
+#if defined(LUAI_SHAPES)
+  for (i -= asize; cast_int(i) < nslots(t); i++) {  /* then slots */
+    if (!isempty(&t->slots[i])) {  /* a non-empty entry? */
+      setsvalue2s(L, key, t->shape->keys[i]);
+      setobj2s(L, key + 1, &t->slots[i]);
+      return (i + 1) + asize;
     }
   }
-  for (i -= asize; cast_int(i) < sizenode(t); i++) {  /* hash part */
+  i -= nslots(t);
+#else
+  i -= asize;
+#endif
+  base = asize + nslots(t);
+  for (; cast_int(i) < sizenode(t); i++) {  /* hash part */
     if (!isempty(gval(gnode(t, i)))) {  /* a non-empty entry? */
       Node *n = gnode(t, i);
       getnodekey(L, s2v(key), n);
       setobj2s(L, key + 1, gval(n));
-      return 1;
+      return (i + 1) + base;
+    }
+  }
+#if defined(LUAI_INCREHASH)
+  if (isrehashing(t)) {  /* then old nodes */
+    base += sizenode(t);
+    for (i -= sizenode(t); i < cast_uint(sizeoldnode(t)); i++) {
+      Node *n = t->oldnode + i;
+      if (!isempty(gval(n))) {  /* a non-empty entry? */
+        getnodekey(L, s2v(key), n);
+        setobj2s(L, key + 1, gval(n));
+        return (i + 1) + base;
+      }
     }
   }
+#endif
   return 0;  /* no more elements */
 }
 
 
+int luaH_next (lua_State *L, Table *t, StkId key) {
+  unsigned int asize = luaH_realasize(t);
+  unsigned int i = findindex(L, t, s2v(key), asize);  /* find original key */
+  return (nextentry(L, t, key, asize, i) != 0);
+}
+
+
+/*
+** Fast path for 'OP_TFORCALL', used by the interpreter and by compiled
+** code: if the iterator function at 'ra' is 'next' of the base library
+** (see 'luaopen_base') and its state at 'ra + 1' is a table, do the call
+** without a CallInfo, leaving 'nresults' results at 'ra + 4', and return
+** 1. The table keeps in 't->cursor' the index of the entry returned last
+** by this function. If the control variable at 'ra + 2' is still the key
+** of that entry, the traversal continues from there without looking for
+** the key in the table. Otherwise (other traversals of the same table
+** in between, a changed control variable, or keys moved by a rehash),
+** it looks for the key as 'next' does. Return 0 and change nothing when
+** this is not such a loop or the key is not in the table; the caller
+** does the usual call, which also raises any error.
+*/
+int luaH_tfornext (lua_State *L, StkId ra, int nresults) {
+  Table *t;
+  unsigned int asize, i;
+  int n;
+  if (!(ttislcf(s2v(ra)) && fvalue(s2v(ra)) == G(L)->vmfuncs[LUA_VMF_NEXT] &&
+        ttistable(s2v(ra + 1))))
+    return 0;  /* not 'next' over a table */
+  t = hvalue(s2v(ra + 1));
+  asize = luaH_realasize(t);
+  if (iskeyat(t, s2v(ra + 2), asize, t->cursor))
+    i = t->cursor;  /* continue after the previous entry */
+  else if ((i = keyindex(t, s2v(ra + 2), asize)) == NOKEYINDEX)
+    return 0;  /* let 'next' raise the error */
+  i = nextentry(L, t, ra + 4, asize, i);
+  t->cursor = i;
+  if (i == 0) {  /* no more elements? */
+    setnilvalue(s2v(ra + 4));
+    n = 1;
+  }
+  else
+    n = 2;  /* key and value */
+  for (; n < nresults; n++)  /* complete required results with nil */
+    setnilvalue(s2v(ra + 4 + n));
+  return 1;
+}
+
+
 static void freehash (lua_State *L, Table *t) {
-  if (!isdummy(t))
+  if (!isdummy(t)) {
+#if defined(LUAI_SWISSTABLE)
+    luaM_freemem(L, t->node, sizehashpart(sizenode(t)));
+#else
     luaM_freearray(L, t->node, cast_sizet(sizenode(t)));
+#endif
+  }
 }
 
 
@@ -432,7 +1021,7 @@ static unsigned int numusearray (const Table *t, unsigned int *nums) {
     }
     /* count elements in range (2^(lg - 1), 2^lg] */
     for (; i <= lim; i++) {
-      if (!isempty(&t->array[i-1]))
+      if (!arrayisempty(t, i - 1))
         lc++;
     }
     nums[lg] += lc;
@@ -466,6 +1055,47 @@ static int numusehash (const Table *t, unsigned int *nums, unsigned int *pna) {
 ** comparison ensures that the shift in the second one does not
 ** overflow.
 */
+#if defined(LUAI_SWISSTABLE)
+
+/*
+** Creates the nodes and control bytes for the hash part of a table
+** with room for 'size' keys, or reuses the dummy node if size is zero.
+** Both arrays go in one block, so that a failed allocation cannot
+** leave one of them behind.
+*/
+static void setnodevector (lua_State *L, Table *t, unsigned int size) {
+  if (size == 0) {  /* no elements to hash part? */
+    t->node = cast(Node *, dummynode);  /* use common 'dummynode' */
+    t->lsizenode = 0;
+    t->lastfree = NULL;  /* signal that it is using dummy node */
+    t->ctrl = cast(lu_byte *, dummyctrl);
+    t->growthleft = 0;
+  }
+  else {
+    int i;
+    int lsize = luaO_ceillog2(size);
+    if (lsize <= MAXHBITS && size > maxgrowth(1u << lsize))
+      lsize++;  /* keep the load factor at most 7/8 */
+    if (lsize > MAXHBITS || (1u << lsize) > MAXHSIZE)
+      luaG_runerror(L, "table overflow");
+    size = twoto(lsize);
+    t->node = cast(Node *, luaM_malloc_(L, sizehashpart(size), 0));
+    for (i = 0; i < (int)size; i++) {
+      Node *n = gnode(t, i);
+      gnext(n) = 0;
+      setnilkey(n);
+      setempty(gval(n));
+    }
+    t->ctrl = cast(lu_byte *, t->node + size);
+    memset(t->ctrl, CTRLEMPTY, sizectrl(size));
+    t->lsizenode = cast_byte(lsize);
+    t->lastfree = gnode(t, size);  /* signal that it is not dummy */
+    t->growthleft = cast_int(maxgrowth(size));
+  }
+}
+
+#else
+
 static void setnodevector (lua_State *L, Table *t, unsigned int size) {
   if (size == 0) {  /* no elements to hash part? */
     t->node = cast(Node *, dummynode);  /* use common 'dummynode' */
@@ -490,6 +1120,8 @@ static void setnodevector (lua_State *L, Table *t, unsigned int size) {
   }
 }
 
+#endif
+
 
 /*
 ** (Re)insert all elements from the hash part of 'ot' into table 't'.
@@ -523,14 +1155,323 @@ static void exchangehashpart (Table *t1, Table *t2) {
   t2->lsizenode = lsizenode;
   t2->node = node;
   t2->lastfree = lastfree;
+#if defined(LUAI_SWISSTABLE)
+  { lu_byte *ctrl = t1->ctrl;
+    int growthleft = t1->growthleft;
+    t1->ctrl = t2->ctrl;
+    t1->growthleft = t2->growthleft;
+    t2->ctrl = ctrl;
+    t2->growthleft = growthleft; }
+#endif
+}
+
+
+#if !defined(LUAI_SWISSTABLE)
+
+static Node *getfreepos (Table *t) {
+  if (!isdummy(t)) {
+    while (t->lastfree > t->node) {
+      t->lastfree--;
+      if (keyisnil(t->lastfree))
+        return t->lastfree;
+    }
+  }
+  return NULL;  /* could not find a free place */
 }
 
 
 /*
-** Resize table 't' for the new given sizes. Both allocations (for
-** the hash part and for the array part) can fail, which creates some
-** subtleties. If the first allocation, for the hash part, fails, an
-** error is raised and that is it. Otherwise, it copies the elements from
+** Get a node for new key 'key' in the hash part of 't'; first, check
+** whether key's main position is free. If not, check whether colliding
+** node is in its main position or not: if it is not, move colliding
+** node to an empty place and give its main position to the new key;
+** otherwise (colliding node is in its main position), new key goes to
+** an empty position. Returns NULL if there is no empty position.
+*/
+static Node *getnewnode (Table *t, const TValue *key) {
+  Node *mp = mainpositionTV(t, key);
+  if (!isempty(gval(mp)) || isdummy(t)) {  /* main position is taken? */
+    Node *othern;
+    Node *f = getfreepos(t);  /* get a free place */
+    if (f == NULL)  /* cannot find a free place? */
+      return NULL;
+    lua_assert(!isdummy(t));
+    othern = mainposition(t, keytt(mp), &keyval(mp));
+    if (othern != mp) {  /* is colliding node out of its main position? */
+      /* yes; move colliding node into free position */
+      while (othern + gnext(othern) != mp)  /* find previous */
+        othern += gnext(othern);
+      gnext(othern) = cast_int(f - othern);  /* rechain to point to 'f' */
+      *f = *mp;  /* copy colliding node into free pos. (mp->next also goes) */
+      if (gnext(mp) != 0) {
+        gnext(f) += cast_int(mp - f);  /* correct 'next' */
+        gnext(mp) = 0;  /* now 'mp' is free */
+      }
+      setempty(gval(mp));
+    }
+    else {  /* colliding node is in its own main position */
+      /* new node will go into free position */
+      if (gnext(mp) != 0)
+        gnext(f) = cast_int((mp + gnext(mp)) - f);  /* chain new position */
+      else lua_assert(gnext(f) == 0);
+      gnext(mp) = cast_int(f - mp);
+      mp = f;
+    }
+  }
+  return mp;
+}
+
+#endif
+
+
+#if defined(LUAI_INCREHASH)
+
+/*
+** {=============================================================
+** Incremental rehash
+** ===============================================================
+** When a hash part with at least MINCREHASH nodes fills up and the
+** array part keeps its size, its keys are not reinserted all at once.
+** Instead, the table gets a new node array and keeps the current one in
+** 'oldnode', and each new key moves INCRSTEP more nodes from the old
+** array to the new one. Meanwhile lookups search both arrays, and each
+** key is in only one of them: a moved node leaves its old node empty,
+** and new keys always go to the new array. (Lookups do not move nodes,
+** as they happen during traversals, and callers keep the slots they
+** return.) The new array has room for all keys of the old one plus the
+** keys inserted until all nodes move, so it cannot fill up before that.
+** ===============================================================
+*/
+
+/* hash parts with at least this many nodes grow incrementally */
+#define MINCREHASH	(1u << 12)
+
+/* number of old nodes moved for each new key */
+#define INCRSTEP	16u
+
+
+/*
+** Move the next 'n' nodes of the old node array of 't' to its node
+** array, freeing the old array after its last node.
+*/
+static void movenodes (lua_State *L, Table *t, unsigned int n) {
+  unsigned int size = sizeoldnode(t);
+  for (; n > 0 && t->nmoved < size; n--) {
+    Node *old = t->oldnode + t->nmoved++;
+    if (!isempty(gval(old))) {
+      /* doesn't need barrier/invalidate cache, as entry was
+         already present in the table */
+      TValue k;
+      Node *mp;
+      getnodekey(L, &k, old);
+      mp = getnewnode(t, &k);
+      lua_assert(mp != NULL);  /* new array has room for all keys */
+      setnodekey(L, mp, &k);
+      setobj2t(L, gval(mp), gval(old));
+      setempty(gval(old));
+    }
+  }
+  if (t->nmoved == size) {  /* moved all nodes? */
+    luaM_freearray(L, t->oldnode, size);
+    t->oldnode = NULL;
+  }
+}
+
+
+static void finishrehash (lua_State *L, Table *t) {
+  if (isrehashing(t))
+    movenodes(L, t, sizeoldnode(t));
+}
+
+
+/*
+** Start to rehash the hash part of 't', which needs room for 'nh' keys
+** (including the new one), if it is large enough and the array part
+** keeps its size 'asize'. Otherwise returns 0, and the caller does a
+** full resize.
+*/
+static int startrehash (lua_State *L, Table *t, unsigned int asize,
+                                                unsigned int nh) {
+  unsigned int size = allocsizenode(t);
+  Table newt;  /* to keep the new hash part */
+  if (size < MINCREHASH || asize != t->alimit)
+    return 0;
+  /* also room for the keys inserted while moving */
+  setnodevector(L, &newt, nh + size / INCRSTEP + 1);
+  t->oldnode = t->node;
+  t->oldlsizenode = t->lsizenode;
+  t->nmoved = 0;
+  t->node = newt.node;
+  t->lsizenode = newt.lsizenode;
+  t->lastfree = newt.lastfree;
+  return 1;
+}
+
+/* }============================================================= */
+
+#else
+
+#define finishrehash(L,t)	((void)0)
+
+#endif
+
+
+#if defined(LUAI_SHAPES)
+
+/*
+** Move the fields of 't' from its shape to an ordinary hash part, with
+** room for at least 'extra' more keys, and free its shape and slots.
+** 't' has no hash part, so it only has to get the new one.
+*/
+static void unshape (lua_State *L, Table *t, unsigned int extra) {
+  Shape *s = t->shape;
+  TValue *slots = t->slots;
+  int sizeslots = t->sizeslots;
+  unsigned int size = s->nkeys + extra;
+  int i;
+  Table newt;  /* to build the new hash part */
+  lua_assert(isdummy(t));
+  if (size < cast_uint(sizeslots))
+    size = sizeslots;  /* keep the room reserved for the slots */
+  setnodevector(L, &newt, size);
+  exchangehashpart(t, &newt);  /* 't' has the new (empty) hash part */
+  t->shape = NULL;
+  t->slots = NULL;
+  t->sizeslots = 0;
+  for (i = 0; i < s->nkeys; i++) {
+    if (!isempty(&slots[i])) {
+      /* doesn't need barrier/invalidate cache, as entry was
+         already present in the table */
+      TValue k;
+      setsvalue(L, &k, s->keys[i]);
+      luaH_set(L, t, &k, &slots[i]);
+    }
+  }
+  luaM_freearray(L, slots, sizeslots);
+  releaseshape(L, s);
+}
+
+#endif
+
+
+#if defined(LUAI_TYPEDARRAY)
+
+/*
+** {==================================================================
+** Typed array parts
+** ===================================================================
+** When all elements in the array part of a table are floats, or all
+** are integers, 'rehash' changes it to a typed array part, which keeps
+** only their 'Value's, in half the memory (see 'ltable.h'). Storing
+** nil in it keeps it typed; storing any other value of another type
+** changes it back to TValues.
+** ===================================================================
+*/
+
+#define setarrayempty(t,n) \
+	{ if (isarraytyped(t)) rawarray(t)[n].i = ARRAYEMPTY; \
+	  else setempty(&(t)->array[n]); }
+
+
+/*
+** Change the array part of 't' to a typed one, if all its elements are
+** numbers of the same type (and there is at least one of them).
+*/
+static void typearray (lua_State *L, Table *t) {
+  unsigned int size = luaH_realasize(t);
+  lu_byte kind = 0;
+  unsigned int i;
+  Value *raw;
+  for (i = 0; i < size; i++) {
+    const TValue *v = &t->array[i];
+    if (isempty(v))
+      continue;
+    if (!ttisnumber(v) || val_(v).i == ARRAYEMPTY ||
+        (kind != 0 && rawtt(v) != kind))
+      return;  /* array part cannot be typed */
+    kind = cast_byte(rawtt(v));
+  }
+  if (kind == 0)
+    return;  /* no elements to give it a type */
+  raw = luaM_newvector(L, size, Value);
+  for (i = 0; i < size; i++) {
+    if (isempty(&t->array[i]))
+      raw[i].i = ARRAYEMPTY;
+    else
+      raw[i] = val_(&t->array[i]);
+  }
+  luaM_freearray(L, t->array, size);
+  t->array = cast(TValue *, raw);
+  t->akind = kind;
+}
+
+
+/* change the typed array part of 't' back to TValues */
+static void untypearray (lua_State *L, Table *t) {
+  unsigned int size = luaH_realasize(t);
+  Value *raw = rawarray(t);
+  TValue *array = luaM_newvector(L, size, TValue);
+  unsigned int i;
+  for (i = 0; i < size; i++) {
+    if (raw[i].i == ARRAYEMPTY)
+      setempty(&array[i]);
+    else {
+      val_(&array[i]) = raw[i];
+      settt_(&array[i], t->akind);
+    }
+  }
+  luaM_freearray(L, raw, size);
+  t->array = array;
+  t->akind = 0;
+}
+
+
+/*
+** Store 'v' in the element of the typed array part of 't' that was
+** last copied to 'aslot'.
+*/
+void luaH_setarrayslot (lua_State *L, Table *t, const TValue *v) {
+  unsigned int i = t->aslotidx;
+  lua_assert(isarraytyped(t) && i < luaH_realasize(t));
+  if (rawtt(v) == t->akind && val_(v).i != ARRAYEMPTY)
+    rawarray(t)[i] = val_(v);
+  else if (ttisnil(v))
+    rawarray(t)[i].i = ARRAYEMPTY;
+  else {  /* 'v' does not fit in a typed element */
+    untypearray(L, t);
+    setobj2t(L, &t->array[i], v);
+  }
+}
+
+
+/* reallocate the array part of 't', keeping its type */
+static TValue *reallocarraypart (lua_State *L, Table *t,
+                                 unsigned int oldasize, unsigned int newasize) {
+  if (isarraytyped(t)) {
+    Value *raw = luaM_reallocvector(L, rawarray(t), oldasize, newasize, Value);
+    return cast(TValue *, raw);
+  }
+  else
+    return luaM_reallocvector(L, t->array, oldasize, newasize, TValue);
+}
+
+/* }================================================================== */
+
+#else
+
+#define setarrayempty(t,n)	setempty(&(t)->array[n])
+
+#define reallocarraypart(L,t,oa,na) \
+	luaM_reallocvector(L, (t)->array, oa, na, TValue)
+
+#endif
+
+
+/*
+** Resize table 't' for the new given sizes. Both allocations (for
+** the hash part and for the array part) can fail, which creates some
+** subtleties. If the first allocation, for the hash part, fails, an
+** error is raised and that is it. Otherwise, it copies the elements from
 ** the shrinking part of the array (if it is shrinking) into the new
 ** hash. Then it reallocates the array part.  If that fails, the table
 ** is in its original state; the function frees the new hash part and then
@@ -539,12 +1480,14 @@ static void exchangehashpart (Table *t1, Table *t2) {
 ** nils and reinserts the elements of the old hash back into the new
 ** parts of the table.
 */
-void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
+static void resize (lua_State *L, Table *t, unsigned int newasize,
                                           unsigned int nhsize) {
   unsigned int i;
   Table newt;  /* to keep the new hash part */
-  unsigned int oldasize = setlimittosize(t);
+  unsigned int oldasize;
   TValue *newarray;
+  finishrehash(L, t);  /* all keys must be in 'node' */
+  oldasize = setlimittosize(t);
   /* create new hash part with appropriate size into 'newt' */
   setnodevector(L, &newt, nhsize);
   if (newasize < oldasize) {  /* will array shrink? */
@@ -552,14 +1495,18 @@ void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
     exchangehashpart(t, &newt);  /* and new hash */
     /* re-insert into the new hash the elements from vanishing slice */
     for (i = newasize; i < oldasize; i++) {
-      if (!isempty(&t->array[i]))
-        luaH_setint(L, t, i + 1, &t->array[i]);
+      const TValue *v = arrayslot(t, i);
+      if (!isempty(v)) {
+        TValue aux;  /* 'v' may be 'aslot', which 'luaH_setint' reuses */
+        setobj(L, &aux, v);
+        luaH_setint(L, t, i + 1, &aux);
+      }
     }
     t->alimit = oldasize;  /* restore current size... */
     exchangehashpart(t, &newt);  /* and hash (in case of errors) */
   }
   /* allocate new array */
-  newarray = luaM_reallocvector(L, t->array, oldasize, newasize, TValue);
+  newarray = reallocarraypart(L, t, oldasize, newasize);
   if (l_unlikely(newarray == NULL && newasize > 0)) {  /* allocation failed? */
     freehash(L, &newt);  /* release new hash part */
     luaM_error(L);  /* raise error (with array unchanged) */
@@ -569,15 +1516,48 @@ void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
   t->array = newarray;  /* set new array part */
   t->alimit = newasize;
   for (i = oldasize; i < newasize; i++)  /* clear new slice of the array */
-     setempty(&t->array[i]);
+     setarrayempty(t, i);
+#if defined(LUAI_TYPEDARRAY)
+  if (newasize == 0)
+    t->akind = 0;  /* next array part may have another type */
+#endif
   /* re-insert elements from old hash part into new parts */
   reinsert(L, &newt, t);  /* 'newt' now has the old hash */
   freehash(L, &newt);  /* free old hash part */
 }
 
 
+/*
+** With shapes, the hash part of a new table built with up to
+** MAXSHAPEKEYS keys is reserved in its slots instead (a constructor like
+** '{x = 1, y = 2}' does that), and a table with a shape that must get a
+** hash part or a smaller array part first moves its fields to the hash
+** part.
+*/
+void luaH_resize (lua_State *L, Table *t, unsigned int newasize,
+                                          unsigned int nhsize) {
+#if defined(LUAI_SHAPES)
+  if (t->shape == NULL) {
+    if (0 < nhsize && nhsize <= MAXSHAPEKEYS && isdummy(t) &&
+        t->sizeslots == 0) {
+      resizeslots(L, t, nhsize);
+      setshape(L, t, &G(L)->rootshape);
+      nhsize = 0;
+    }
+  }
+  else if (nhsize > 0 || newasize < luaH_realasize(t))
+    unshape(L, t, nhsize);
+#endif
+  resize(L, t, newasize, nhsize);
+}
+
+
 void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize) {
+#if defined(LUAI_SWISSTABLE)
+  int nsize = isdummy(t) ? 0 : maxgrowth(sizenode(t));  /* same size */
+#else
   int nsize = allocsizenode(t);
+#endif
   luaH_resize(L, t, nasize, nsize);
 }
 
@@ -590,6 +1570,7 @@ static void rehash (lua_State *L, Table *t, const TValue *ek) {
   unsigned int nums[MAXABITS + 1];
   int i;
   int totaluse;
+  finishrehash(L, t);  /* count all keys in 'node' */
   for (i = 0; i <= MAXABITS; i++) nums[i] = 0;  /* reset counts */
   setlimittosize(t);
   na = numusearray(t, nums);  /* count keys in array part */
@@ -601,8 +1582,16 @@ static void rehash (lua_State *L, Table *t, const TValue *ek) {
   totaluse++;
   /* compute new size for array part */
   asize = computesizes(nums, &na);
+#if defined(LUAI_INCREHASH)
+  if (startrehash(L, t, asize, totaluse - na))
+    return;  /* keys will move a few at a time */
+#endif
   /* resize the table to new computed sizes */
-  luaH_resize(L, t, asize, totaluse - na);
+  resize(L, t, asize, totaluse - na);
+#if defined(LUAI_TYPEDARRAY)
+  if (!isarraytyped(t))
+    typearray(L, t);
+#endif
 }
 
 
@@ -619,6 +1608,23 @@ Table *luaH_new (lua_State *L) {
   t->flags = cast_byte(maskflags);  /* table has no metamethod fields */
   t->array = NULL;
   t->alimit = 0;
+  t->border = 0;
+  t->cursor = 0;
+#if defined(LUAI_SHAPES)
+  t->shape = NULL;
+  t->slots = NULL;
+  t->sizeslots = 0;
+#endif
+#if defined(LUAI_TYPEDARRAY)
+  t->akind = 0;
+  t->aslotidx = 0;
+  setempty(&t->aslot);
+#endif
+#if defined(LUAI_INCREHASH)
+  t->oldlsizenode = 0;
+  t->nmoved = 0;
+  t->oldnode = NULL;
+#endif
   setnodevector(L, t, 0);
   return t;
 }
@@ -626,34 +1632,212 @@ Table *luaH_new (lua_State *L) {
 
 void luaH_free (lua_State *L, Table *t) {
   freehash(L, t);
+#if defined(LUAI_INCREHASH)
+  if (isrehashing(t))
+    luaM_freearray(L, t->oldnode, sizeoldnode(t));
+#endif
+#if defined(LUAI_SHAPES)
+  freeshape(L, t);
+#endif
+#if defined(LUAI_TYPEDARRAY)
+  if (isarraytyped(t))
+    luaM_freearray(L, rawarray(t), luaH_realasize(t));
+  else
+#endif
   luaM_freearray(L, t->array, luaH_realasize(t));
   luaM_free(L, t);
 }
 
 
-static Node *getfreepos (Table *t) {
+/*
+** Remove all entries of 't', keeping all its parts (and its shape, whose
+** slots become empty) for the keys that will be inserted later.
+*/
+void luaH_clear (lua_State *L, Table *t) {
+  unsigned int i;
+  unsigned int asize = luaH_realasize(t);
+#if defined(LUAI_INCREHASH)
+  if (isrehashing(t)) {  /* drop the old node array */
+    luaM_freearray(L, t->oldnode, sizeoldnode(t));
+    t->oldnode = NULL;
+  }
+#else
+  UNUSED(L);
+#endif
+  t->border = 0;
+  for (i = 0; i < asize; i++)
+    setarrayempty(t, i);
   if (!isdummy(t)) {
-    while (t->lastfree > t->node) {
-      t->lastfree--;
-      if (keyisnil(t->lastfree))
-        return t->lastfree;
+    unsigned int size = sizenode(t);
+    for (i = 0; i < size; i++) {
+      Node *n = gnode(t, i);
+      gnext(n) = 0;
+      setnilkey(n);
+      setempty(gval(n));
     }
+    t->lastfree = gnode(t, size);  /* all positions are free */
+#if defined(LUAI_SWISSTABLE)
+    memset(t->ctrl, CTRLEMPTY, sizectrl(size));
+    t->growthleft = cast_int(maxgrowth(size));
+#endif
   }
-  return NULL;  /* could not find a free place */
+#if defined(LUAI_SHAPES)
+  for (i = 0; i < t->sizeslots; i++)
+    setempty(&t->slots[i]);
+#endif
 }
 
 
+/*
+** Fast path for a call with 'nargs' arguments to the function in 'func',
+** used by compiled code: if it is 'table.new' or 'table.clear' of the
+** table library (see 'luaopen_table') and the arguments do not need any
+** conversion, do the call without a CallInfo, leaving 'nresults' results
+** at 'func', and return 1. Otherwise return 0 and change nothing; the
+** caller does the usual call, which also raises any error.
+*/
+int luaH_tablecall (lua_State *L, StkId func, int nargs, int nresults) {
+  const TValue *f = s2v(func);
+  int i;
+  if (!ttisleaf(f))
+    return 0;  /* both functions are leaf functions */
+  if (fvalue(f) == G(L)->vmfuncs[LUA_VMF_TABLENEW]) {
+    lua_Integer size[2] = {0, 0};  /* array and hash sizes */
+    Table *t;
+    for (i = 0; i < nargs && i < 2; i++) {
+      const TValue *o = s2v(func + 1 + i);
+      if (ttisinteger(o) && 0 <= ivalue(o) && ivalue(o) <= INT_MAX)
+        size[i] = ivalue(o);
+      else if (!ttisnil(o))
+        return 0;  /* let 'table.new' convert it or raise the error */
+    }
+    t = luaH_new(L);
+    sethvalue2s(L, func, t);
+    if (size[0] > 0 || size[1] > 0)
+      luaH_resize(L, t, cast_uint(size[0]), cast_uint(size[1]));
+    i = 1;  /* one result */
+  }
+  else if (fvalue(f) == G(L)->vmfuncs[LUA_VMF_TABLECLEAR]) {
+    if (nargs < 1 || !ttistable(s2v(func + 1)))
+      return 0;  /* let 'table.clear' raise the error */
+    luaH_clear(L, hvalue(s2v(func + 1)));
+    i = 0;  /* no results */
+  }
+  else
+    return 0;
+  for (; i < nresults; i++)  /* complete required results with nil */
+    setnilvalue(s2v(func + i));
+  return 1;
+}
+
 
 /*
-** inserts a new key into a hash table; first, check whether key's main
-** position is free. If not, check whether colliding node is in its main
-** position or not: if it is not, move colliding node to an empty place and
-** put new key in its main position; otherwise (colliding node is in its main
-** position), new key goes to an empty position.
+** {==================================================================
+** Bulk operations on array parts
+** ===================================================================
+** These functions do in one step what 'table.move' and 'table.fill'
+** would do element by element, when the result is the same as with raw
+** accesses: the source table has no '__index' and the destination has
+** no '__newindex'. They return 0, and change nothing, when they cannot
+** do it; the caller then uses the usual accesses.
+** ===================================================================
+*/
+
+/* does 't' have no metamethod 'e' (TM_INDEX or TM_NEWINDEX)? */
+#define hasnotm(L,t,e)	(fasttm(L, (t)->metatable, e) == NULL)
+
+#if defined(LUAI_TYPEDARRAY)
+/* can 'memmove' copy elements of array part 't1' to array part 't2'? */
+#define samearraykind(t1,t2)	((t1)->akind == (t2)->akind)
+/* size of an element of array part 't' */
+#define arrayesize(t)	(isarraytyped(t) ? sizeof(Value) : sizeof(TValue))
+#else
+#define samearraykind(t1,t2)	1
+#define arrayesize(t)	sizeof(TValue)
+#endif
+
+
+/* after bulk stores, 't' may point to white objects */
+static void bulkbarrier (lua_State *L, Table *t) {
+  if (!isarraytyped(t) && isblack(t))
+    luaC_barrierback_(L, obj2gco(t));
+}
+
+
+/*
+** Copy elements 'f' to 'f + n - 1' of table 'src' to positions 't' to
+** 't + n - 1' of table 'dst' (which can be 'src'), when all of them are
+** in the array parts. Array parts of the same kind are copied with a
+** single 'memmove'.
+*/
+int luaH_movearray (lua_State *L, Table *src, lua_Integer f, lua_Integer n,
+                                  Table *dst, lua_Integer t) {
+  unsigned int i;
+  if (!(hasnotm(L, src, TM_INDEX) && hasnotm(L, dst, TM_NEWINDEX) &&
+        f >= 1 && l_castS2U(f - 1) + l_castS2U(n) <= luaH_realasize(src) &&
+        t >= 1 && l_castS2U(t - 1) + l_castS2U(n) <= luaH_realasize(dst)))
+    return 0;
+  f--; t--;  /* 0-based indices */
+  if (samearraykind(src, dst)) {
+    size_t esize = arrayesize(src);
+    memmove(cast_charp(dst->array) + cast_sizet(t) * esize,
+            cast_charp(src->array) + cast_sizet(f) * esize,
+            cast_sizet(n) * esize);
+  }
+  else {  /* copy element by element, in the direction that avoids overlap */
+    TValue v;
+    for (i = 0; i < cast_uint(n); i++) {
+      unsigned int k = (t > f) ? cast_uint(n) - 1 - i : i;
+      const TValue *e = arrayslot(src, cast_uint(f) + k);
+      if (isempty(e))
+        setnilvalue(&v);  /* 'setobj' does not copy empty slots */
+      else
+        setobj(L, &v, e);
+      setarrayvalue(L, dst, cast_uint(t) + k, &v);
+    }
+  }
+  bulkbarrier(L, dst);
+  return 1;
+}
+
+
+/*
+** Set elements 'i' to 'j' of table 't' to 'v'. If they go past the array
+** part (but start inside it or just after it), first grow the array part
+** to 'j' elements, so that it is allocated only once. (Not for a nil
+** 'v', which must remove elements from the hash part.)
+*/
+int luaH_fillarray (lua_State *L, Table *t, const TValue *v, lua_Integer i,
+                                                             lua_Integer j) {
+  TValue val;
+  unsigned int asize = luaH_realasize(t);
+  unsigned int k;
+  if (!(hasnotm(L, t, TM_NEWINDEX) && 1 <= i && i <= j &&
+        l_castS2U(i - 1) <= asize && l_castS2U(j) <= MAXASIZE &&
+        (l_castS2U(j) <= asize || !ttisnil(v))))
+    return 0;
+  setobj(L, &val, v);  /* 'v' may be an element of 't' */
+  if (l_castS2U(j) > asize)
+    luaH_resizearray(L, t, cast_uint(j));
+  for (k = cast_uint(i) - 1; k < cast_uint(j); k++)
+    setarrayvalue(L, t, k, &val);
+  bulkbarrier(L, t);
+  return 1;
+}
+
+/* }================================================================== */
+
+
+/*
+** inserts a new key into a hash table (see 'getnewnode'), growing it
+** when there is no room for the key.
 */
 void luaH_newkey (lua_State *L, Table *t, const TValue *key, TValue *value) {
   Node *mp;
   TValue aux;
+#if defined(LUAI_SWISSTABLE)
+  const TValue *slot;
+#endif
   if (l_unlikely(ttisnil(key)))
     luaG_runerror(L, "table index is nil");
   else if (ttisfloat(key)) {
@@ -668,39 +1852,43 @@ void luaH_newkey (lua_State *L, Table *t, const TValue *key, TValue *value) {
   }
   if (ttisnil(value))
     return;  /* do not insert nil values */
-  mp = mainpositionTV(t, key);
-  if (!isempty(gval(mp)) || isdummy(t)) {  /* main position is taken? */
-    Node *othern;
-    Node *f = getfreepos(t);  /* get a free place */
-    if (f == NULL) {  /* cannot find a free place? */
-      rehash(L, t, key);  /* grow table */
-      /* whatever called 'newkey' takes care of TM cache */
-      luaH_set(L, t, key, value);  /* insert key into grown table */
-      return;
-    }
-    lua_assert(!isdummy(t));
-    othern = mainposition(t, keytt(mp), &keyval(mp));
-    if (othern != mp) {  /* is colliding node out of its main position? */
-      /* yes; move colliding node into free position */
-      while (othern + gnext(othern) != mp)  /* find previous */
-        othern += gnext(othern);
-      gnext(othern) = cast_int(f - othern);  /* rechain to point to 'f' */
-      *f = *mp;  /* copy colliding node into free pos. (mp->next also goes) */
-      if (gnext(mp) != 0) {
-        gnext(f) += cast_int(mp - f);  /* correct 'next' */
-        gnext(mp) = 0;  /* now 'mp' is free */
-      }
-      setempty(gval(mp));
-    }
-    else {  /* colliding node is in its own main position */
-      /* new node will go into free position */
-      if (gnext(mp) != 0)
-        gnext(f) = cast_int((mp + gnext(mp)) - f);  /* chain new position */
-      else lua_assert(gnext(f) == 0);
-      gnext(mp) = cast_int(f - mp);
-      mp = f;
-    }
+#if defined(LUAI_SHAPES)
+  if (ttisshrstring(key) && (t->shape != NULL || isdummy(t)) &&
+      shapenewkey(L, t, tsvalue(key), value)) {
+    luaC_barrierback(L, obj2gco(t), key);
+    return;
+  }
+  if (t->shape != NULL)  /* key does not fit in the shape? */
+    unshape(L, t, 1);
+#endif
+#if defined(LUAI_INCREHASH)
+  if (isrehashing(t))
+    movenodes(L, t, INCRSTEP);  /* keep moving keys to the new array */
+#endif
+#if defined(LUAI_SWISSTABLE)
+  /* a dead node with this key must be reused; otherwise, a traversal
+     would find that node, instead of the new one, for the key */
+  if (iscollectable(key) && !isabstkey(slot = getgeneric(t, key, 1))) {
+    mp = nodefromval(slot);
+    setctrl(t, cast_uint(mp - gnode(t, 0)), ctrltag(hashkeyTV(key)));
   }
+  else if (t->growthleft == 0) {  /* no room for another key? */
+    rehash(L, t, key);  /* grow table */
+    /* whatever called 'newkey' takes care of TM cache */
+    luaH_set(L, t, key, value);  /* insert key into grown table */
+    return;
+  }
+  else
+    mp = getfreepos(t, hashkeyTV(key));
+#else
+  mp = getnewnode(t, key);
+  if (mp == NULL) {  /* cannot find a free place? */
+    rehash(L, t, key);  /* grow table */
+    /* whatever called 'newkey' takes care of TM cache */
+    luaH_set(L, t, key, value);  /* insert key into grown table */
+    return;
+  }
+#endif
   setnodekey(L, mp, key);
   luaC_barrierback(L, obj2gco(t), key);
   lua_assert(isempty(gval(mp)));
@@ -718,14 +1906,32 @@ void luaH_newkey (lua_State *L, Table *t, const TValue *key, TValue *value) {
 */
 const TValue *luaH_getint (Table *t, lua_Integer key) {
   if (l_castS2U(key) - 1u < t->alimit)  /* 'key' in [1, t->alimit]? */
-    return &t->array[key - 1];
+    return arrayslot(t, key - 1);
   else if (!limitequalsasize(t) &&  /* key still may be in the array part? */
            (l_castS2U(key) == t->alimit + 1 ||
             l_castS2U(key) - 1u < luaH_realasize(t))) {
     t->alimit = cast_uint(key);  /* probably '#t' is here now */
-    return &t->array[key - 1];
+    return arrayslot(t, key - 1);
   }
   else {
+#if defined(LUAI_SWISSTABLE)
+    unsigned int mask = sizenode(t) - 1;
+    unsigned int h = mixhash(foldint(l_castS2U(key)));
+    unsigned int pos = h & mask;
+    unsigned int step = 0;
+    for (;;) {  /* check whether 'key' is somewhere in its probe sequence */
+      const lu_byte *g = t->ctrl + pos;
+      unsigned int m;
+      for (m = matchbyte(g, ctrltag(h)); m != 0; m &= m - 1) {
+        Node *n = gnode(t, (pos + lowbit(m)) & mask);
+        if (keyisinteger(n) && keyival(n) == key)
+          return gval(n);  /* that's it */
+      }
+      if (matchempty(g) != 0 || (step += GROUPSIZE) > mask)
+        break;  /* not found */
+      pos = (pos + step) & mask;
+    }
+#else
     Node *n = hashint(t, key);
     for (;;) {  /* check whether 'key' is somewhere in the chain */
       if (keyisinteger(n) && keyival(n) == key)
@@ -736,6 +1942,14 @@ const TValue *luaH_getint (Table *t, lua_Integer key) {
         n += nx;
       }
     }
+#endif
+#if defined(LUAI_INCREHASH)
+    if (isrehashing(t)) {
+      TValue k;
+      setivalue(&k, key);
+      return getold(t, &k, 0);
+    }
+#endif
     return &absentkey;
   }
 }
@@ -744,21 +1958,62 @@ const TValue *luaH_getint (Table *t, lua_Integer key) {
 /*
 ** search function for short strings
 */
+#if defined(LUAI_SWISSTABLE)
+
+const TValue *luaH_getshortstr (Table *t, TString *key) {
+  unsigned int mask = sizenode(t) - 1;
+  unsigned int h = key->hash;
+  unsigned int pos = h & mask;
+  unsigned int step = 0;
+  lua_assert(key->tt == LUA_VSHRSTR);
+#if defined(LUAI_SHAPES)
+  if (t->shape != NULL)
+    return getshapefield(t, key);
+#endif
+  for (;;) {  /* check whether 'key' is somewhere in its probe sequence */
+    const lu_byte *g = t->ctrl + pos;
+    unsigned int m;
+    for (m = matchbyte(g, ctrltag(h)); m != 0; m &= m - 1) {
+      Node *n = gnode(t, (pos + lowbit(m)) & mask);
+      if (keyisshrstr(n) && eqshrstr(keystrval(n), key))
+        return gval(n);  /* that's it */
+    }
+    if (matchempty(g) != 0 || (step += GROUPSIZE) > mask)
+      return &absentkey;  /* not found */
+    pos = (pos + step) & mask;
+  }
+}
+
+#else
+
 const TValue *luaH_getshortstr (Table *t, TString *key) {
   Node *n = hashstr(t, key);
   lua_assert(key->tt == LUA_VSHRSTR);
+#if defined(LUAI_SHAPES)
+  if (t->shape != NULL)
+    return getshapefield(t, key);
+#endif
   for (;;) {  /* check whether 'key' is somewhere in the chain */
     if (keyisshrstr(n) && eqshrstr(keystrval(n), key))
       return gval(n);  /* that's it */
     else {
       int nx = gnext(n);
-      if (nx == 0)
-        return &absentkey;  /* not found */
+      if (nx == 0) break;
       n += nx;
     }
   }
+#if defined(LUAI_INCREHASH)
+  if (isrehashing(t)) {
+    TValue k;
+    setsvalue(cast(lua_State *, NULL), &k, key);
+    return getold(t, &k, 0);
+  }
+#endif
+  return &absentkey;  /* not found */
 }
 
+#endif
+
 
 const TValue *luaH_getstr (Table *t, TString *key) {
   if (key->tt == LUA_VSHRSTR)
@@ -766,7 +2021,7 @@ const TValue *luaH_getstr (Table *t, TString *key) {
   else {  /* for long strings, use generic case */
     TValue ko;
     setsvalue(cast(lua_State *, NULL), &ko, key);
-    return getgeneric(t, &ko, 0);
+    return gethash(t, &ko);
   }
 }
 
@@ -786,7 +2041,7 @@ const TValue *luaH_get (Table *t, const TValue *key) {
       /* else... */
     }  /* FALLTHROUGH */
     default:
-      return getgeneric(t, key, 0);
+      return gethash(t, key);
   }
 }
 
@@ -802,7 +2057,7 @@ void luaH_finishset (lua_State *L, Table *t, const TValue *key,
   if (isabstkey(slot))
     luaH_newkey(L, t, key, value);
   else
-    setobj2t(L, cast(TValue *, slot), value);
+    setslotvalue(L, t, slot, value);
 }
 
 
@@ -824,7 +2079,7 @@ void luaH_setint (lua_State *L, Table *t, lua_Integer key, TValue *value) {
     luaH_newkey(L, t, &k, value);
   }
   else
-    setobj2t(L, cast(TValue *, p), value);
+    setslotvalue(L, t, p, value);
 }
 
 
@@ -866,17 +2121,67 @@ static lua_Unsigned hash_search (Table *t, lua_Unsigned j) {
 }
 
 
-static unsigned int binsearch (const TValue *array, unsigned int i,
-                                                    unsigned int j) {
+static unsigned int binsearch (const Table *t, unsigned int i,
+                                                unsigned int j) {
   while (j - i > 1u) {  /* binary search */
     unsigned int m = (i + j) / 2;
-    if (isempty(&array[m - 1])) j = m;
+    if (arrayisempty(t, m - 1)) j = m;
     else i = m;
   }
   return i;
 }
 
 
+/*
+** Largest boundary kept in 't->border', so that 'border + 2' is still
+** a valid key.
+*/
+#if LUA_MAXINTEGER < UINT_MAX
+#define MAXBORDER	(cast_uint(LUA_MAXINTEGER) - 2)
+#else
+#define MAXBORDER	(UINT_MAX - 2)
+#endif
+
+
+/*
+** Find a boundary of table 't' in its hash part, knowing that 'j' (the
+** size of the array part) is zero or present and that 'j + 1' is
+** present. 't->border' is the boundary found by the previous call; it
+** is still a boundary unless the table changed around it, and the
+** usual changes ('t[#t+1]=v' and 't[#t]=nil') move it by one. Only when
+** these checks fail does 'hash_search' look for a boundary, which then
+** becomes the new 't->border'.
+*/
+static lua_Unsigned hash_border (global_State *g, Table *t, lua_Unsigned j) {
+  lua_Integer b = t->border;
+  if (l_castS2U(b) > j) {  /* can 'b' (or 'b - 1') be a boundary? */
+    if (!isempty(luaH_getint(t, b))) {  /* 'b' present? */
+      if (isempty(luaH_getint(t, b + 1)))
+        return l_castS2U(b);  /* 'b + 1' absent: 'b' still is a boundary */
+      else if (isempty(luaH_getint(t, b + 2))) {  /* appended one key */
+        t->border = cast_uint(b + 1);
+        return l_castS2U(b + 1);
+      }
+    }
+    else if (!isempty(luaH_getint(t, b - 1))) {  /* removed one key */
+      t->border = cast_uint(b - 1);
+      return l_castS2U(b - 1);
+    }
+  }
+  g->lensearches++;
+  j = hash_search(t, j);
+  t->border = (j <= MAXBORDER) ? cast_uint(j) : 0;
+  return j;
+}
+
+
+#if defined(LUAI_LENSTATS)
+#define countlen(g)	((g)->lencount++)
+#else
+#define countlen(g)	((void)0)
+#endif
+
+
 /*
 ** Try to find a boundary in table 't'. (A 'boundary' is an integer index
 ** such that t[i] is present and t[i+1] is absent, or 0 if t[1] is absent
@@ -905,15 +2210,21 @@ static unsigned int binsearch (const TValue *array, unsigned int i,
 ** (limit == 0) or its last element (the new limit) is present.
 ** In this case, must check the hash part. If there is no hash part
 ** or 'limit+1' is absent, 'limit' is a boundary.  Otherwise, call
-** 'hash_search' to find a boundary in the hash part of the table.
+** 'hash_border' to find a boundary in the hash part of the table.
 ** (In those cases, the boundary is not inside the array part, and
-** therefore cannot be used as a new limit.)
+** therefore cannot be used as a new limit; 'hash_border' keeps it
+** in 't->border' instead.)
+**
+** 'G(L)->lensearches' counts the calls that had to do a binary search,
+** and 'G(L)->lencount' all calls, with LUAI_LENSTATS (see 'lua_lenstats').
 */
-lua_Unsigned luaH_getn (Table *t) {
+lua_Unsigned luaH_getn (lua_State *L, Table *t) {
+  global_State *g = G(L);
   unsigned int limit = t->alimit;
-  if (limit > 0 && isempty(&t->array[limit - 1])) {  /* (1)? */
+  countlen(g);
+  if (limit > 0 && arrayisempty(t, limit - 1)) {  /* (1)? */
     /* there must be a boundary before 'limit' */
-    if (limit >= 2 && !isempty(&t->array[limit - 2])) {
+    if (limit >= 2 && !arrayisempty(t, limit - 2)) {
       /* 'limit - 1' is a boundary; can it be a new limit? */
       if (ispow2realasize(t) && !ispow2(limit - 1)) {
         t->alimit = limit - 1;
@@ -922,7 +2233,8 @@ lua_Unsigned luaH_getn (Table *t) {
       return limit - 1;
     }
     else {  /* must search for a boundary in [0, limit] */
-      unsigned int boundary = binsearch(t->array, 0, limit);
+      unsigned int boundary = binsearch(t, 0, limit);
+      g->lensearches++;
       /* can this boundary represent the real size of the array? */
       if (ispow2realasize(t) && boundary > luaH_realasize(t) / 2) {
         t->alimit = boundary;  /* use it as the new limit */
@@ -934,14 +2246,15 @@ lua_Unsigned luaH_getn (Table *t) {
   /* 'limit' is zero or present in table */
   if (!limitequalsasize(t)) {  /* (2)? */
     /* 'limit' > 0 and array has more elements after 'limit' */
-    if (isempty(&t->array[limit]))  /* 'limit + 1' is empty? */
+    if (arrayisempty(t, limit))  /* 'limit + 1' is empty? */
       return limit;  /* this is the boundary */
     /* else, try last element in the array */
     limit = luaH_realasize(t);
-    if (isempty(&t->array[limit - 1])) {  /* empty? */
+    if (arrayisempty(t, limit - 1)) {  /* empty? */
       /* there must be a boundary in the array after old limit,
          and it must be a valid new limit */
-      unsigned int boundary = binsearch(t->array, t->alimit, limit);
+      unsigned int boundary = binsearch(t, t->alimit, limit);
+      g->lensearches++;
       t->alimit = boundary;
       return boundary;
     }
@@ -949,21 +2262,69 @@ lua_Unsigned luaH_getn (Table *t) {
   }
   /* (3) 'limit' is the last element and either is zero or present in table */
   lua_assert(limit == luaH_realasize(t) &&
-             (limit == 0 || !isempty(&t->array[limit - 1])));
+             (limit == 0 || !arrayisempty(t, limit - 1)));
   if (isdummy(t) || isempty(luaH_getint(t, cast(lua_Integer, limit + 1))))
     return limit;  /* 'limit + 1' is absent */
   else  /* 'limit + 1' is also present */
-    return hash_search(t, limit);
+    return hash_border(g, t, limit);
 }
 
 
 
+/*
+** Statistics of the hash part of table 't' (see 'lua_gethashstats'):
+** its number of keys with values and the total and maximum number of
+** probes that a search for each of these keys does. A probe is a node
+** of the key's chain, or a group of nodes with Swiss tables. (The old
+** nodes of a table being rehashed are not counted.)
+*/
+void luaH_hashstats (Table *t, unsigned int *nkeys, lua_Unsigned *probes,
+                                                    unsigned int *maxprobes) {
+  unsigned int i;
+  *nkeys = *maxprobes = 0;
+  *probes = 0;
+  if (isdummy(t))
+    return;
+  for (i = 0; i < cast_uint(sizenode(t)); i++) {
+    Node *n = gnode(t, i);
+    unsigned int np = 1;
+    if (isempty(gval(n)))
+      continue;
+#if defined(LUAI_SWISSTABLE)
+    {
+      unsigned int mask = sizenode(t) - 1;
+      unsigned int pos = hashkey(keytt(n), &keyval(n)) & mask;
+      unsigned int step = 0;
+      while (((i - pos) & mask) >= GROUPSIZE) {  /* not in this group? */
+        pos = (pos + (step += GROUPSIZE)) & mask;
+        np++;
+      }
+    }
+#else
+    {
+      Node *mp = mainposition(t, keytt(n), &keyval(n));
+      for (; mp != n; mp += gnext(mp))  /* walk the chain up to 'n' */
+        np++;
+    }
+#endif
+    (*nkeys)++;
+    *probes += np;
+    if (np > *maxprobes)
+      *maxprobes = np;
+  }
+}
+
+
 #if defined(LUA_DEBUG)
 
 /* export these functions for the test library */
 
 Node *luaH_mainposition (const Table *t, const TValue *key) {
+#if defined(LUAI_SWISSTABLE)
+  return gnode(t, lmod(hashkeyTV(key), sizenode(t)));
+#else
   return mainpositionTV(t, key);
+#endif
 }
 
 int luaH_isdummy (const Table *t) { return isdummy(t); }
@@ -31,10 +31,78 @@
 #define allocsizenode(t)	(isdummy(t) ? 0 : sizenode(t))
 
 
+#if defined(LUAI_INCREHASH)
+/* true while 't' is moving its keys from 'oldnode' to 'node' */
+#define isrehashing(t)		((t)->oldnode != NULL)
+#define sizeoldnode(t)		(twoto((t)->oldlsizenode))
+#else
+#define isrehashing(t)		0
+#endif
+
+
 /* returns the Node, given the value of a table entry */
 #define nodefromval(v)	cast(Node *, (v))
 
 
+/* returns the string key, given the value of a table entry */
+#if defined(LUAI_SHAPES)
+#define strkeyfromval(t,v) \
+	((t)->shape != NULL ? (t)->shape->keys[(v) - (t)->slots] \
+	                    : keystrval(nodefromval(v)))
+#else
+#define strkeyfromval(t,v)	keystrval(nodefromval(v))
+#endif
+
+
+#if defined(LUAI_TYPEDARRAY)
+
+/*
+** A typed array part keeps only the 'Value's of its elements, which
+** all have tag 'akind' (a float or an integer variant); an empty
+** element has the bits ARRAYEMPTY (a NaN). Code that wants a TValue
+** gets a pointer to 'aslot', where 'arrayslot' copies the element: it
+** is valid until the next access to the array part, and stores
+** through it must use 'setslotvalue'.
+*/
+#define ARRAYEMPTY	l_castU2S(0x7ff8deadbeef0000ULL)
+
+#define rawarray(t)	cast(Value *, (t)->array)
+#define isarraytyped(t)	((t)->akind != 0)
+
+#define arrayslot(t,n) \
+	(!isarraytyped(t) ? &(t)->array[n] \
+	 : ((t)->aslotidx = (n), val_(&(t)->aslot) = rawarray(t)[n], \
+	    settt_(&(t)->aslot, (rawarray(t)[n].i == ARRAYEMPTY) \
+	                        ? LUA_VEMPTY : (t)->akind), \
+	    &(t)->aslot))
+
+#define arrayisempty(t,n) \
+	(!isarraytyped(t) ? isempty(&(t)->array[n]) \
+	                  : rawarray(t)[n].i == ARRAYEMPTY)
+
+/* set the entry 'slot', got from a search in 't', to 'v' */
+#define setslotvalue(L,t,slot,v) \
+	{ if ((slot) != &(t)->aslot) { setobj2t(L, cast(TValue *, slot), v); } \
+	  else if (rawtt(v) == (t)->akind && val_(v).i != ARRAYEMPTY) \
+	    rawarray(t)[(t)->aslotidx] = val_(v); \
+	  else luaH_setarrayslot(L, t, v); }
+
+/* set element 'n' (0-based) of the array part of 't' to 'v' */
+#define setarrayvalue(L,t,n,v) \
+	{ if (!isarraytyped(t)) { setobj2t(L, &(t)->array[n], v); } \
+	  else { cast_void(arrayslot(t, n)); luaH_setarrayslot(L, t, v); } }
+
+#else
+
+#define isarraytyped(t)	0
+#define arrayslot(t,n)	(&(t)->array[n])
+#define arrayisempty(t,n)	isempty(&(t)->array[n])
+#define setslotvalue(L,t,slot,v)	setobj2t(L, cast(TValue *, slot), v)
+#define setarrayvalue(L,t,n,v)	setobj2t(L, &(t)->array[n], v)
+
+#endif
+
+
 LUAI_FUNC const TValue *luaH_getint (Table *t, lua_Integer key);
 LUAI_FUNC void luaH_setint (lua_State *L, Table *t, lua_Integer key,
                                                     TValue *value);
@@ -52,9 +120,22 @@ LUAI_FUNC void luaH_resize (lua_State *L, Table *t, unsigned int nasize,
                                                     unsigned int nhsize);
 LUAI_FUNC void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize);
 LUAI_FUNC void luaH_free (lua_State *L, Table *t);
+LUAI_FUNC void luaH_clear (lua_State *L, Table *t);
+LUAI_FUNC int luaH_movearray (lua_State *L, Table *src, lua_Integer f,
+                              lua_Integer n, Table *dst, lua_Integer t);
+LUAI_FUNC int luaH_fillarray (lua_State *L, Table *t, const TValue *v,
+                              lua_Integer i, lua_Integer j);
+LUAI_FUNC int luaH_tablecall (lua_State *L, StkId func, int nargs,
+                                                        int nresults);
 LUAI_FUNC int luaH_next (lua_State *L, Table *t, StkId key);
-LUAI_FUNC lua_Unsigned luaH_getn (Table *t);
+LUAI_FUNC int luaH_tfornext (lua_State *L, StkId ra, int nresults);
+LUAI_FUNC lua_Unsigned luaH_getn (lua_State *L, Table *t);
+LUAI_FUNC void luaH_hashstats (Table *t, unsigned int *nkeys,
+                               lua_Unsigned *probes, unsigned int *maxprobes);
 LUAI_FUNC unsigned int luaH_realasize (const Table *t);
+#if defined(LUAI_TYPEDARRAY)
+LUAI_FUNC void luaH_setarrayslot (lua_State *L, Table *t, const TValue *v);
+#endif
 
 
 #if defined(LUA_DEBUG)
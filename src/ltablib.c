@@ -125,7 +125,11 @@ static int tmove (lua_State *L) {
     n = e - f + 1;  /* number of elements to move */
     luaL_argcheck(L, t <= LUA_MAXINTEGER - n + 1, 4,
                   "destination wrap around");
-    if (t > e || t <= f || (tt != 1 && !lua_compare(L, 1, tt, LUA_OPEQ))) {
+    if (lua_type(L, 1) == LUA_TTABLE && lua_type(L, tt) == LUA_TTABLE &&
+        lua_movearray(L, 1, f, e, tt, t))
+      ;  /* moved directly in the array parts */
+    else if (t > e || t <= f ||
+             (tt != 1 && !lua_compare(L, 1, tt, LUA_OPEQ))) {
       for (i = 0; i < n; i++) {
         lua_geti(L, 1, f + i);
         lua_seti(L, tt, t + i);
@@ -143,6 +147,91 @@ static int tmove (lua_State *L) {
 }
 
 
+/*
+** table.fill(t, v [, i [, j]]): set t[i], ..., t[j] (by default, 1 to #t)
+** to 'v' and return 't'. Elements that go past the array part of 't'
+** grow it only once (see 'lua_fillarray').
+*/
+static int tfill (lua_State *L) {
+  lua_Integer i, j;
+  checktab(L, 1, TAB_W);
+  luaL_checkany(L, 2);
+  i = luaL_optinteger(L, 3, 1);
+  j = lua_isnoneornil(L, 4) ? aux_getn(L, 1, TAB_W) : luaL_checkinteger(L, 4);
+  if (i <= j && !(lua_type(L, 1) == LUA_TTABLE &&
+                  lua_fillarray(L, 1, 2, i, j))) {
+    for (;; i++) {  /* (cannot use 'i <= j', as 'j' may be LUA_MAXINTEGER) */
+      lua_pushvalue(L, 2);
+      lua_seti(L, 1, i);
+      if (i == j) break;
+    }
+  }
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/*
+** table.slice(t [, i [, j]]): return a new list with t[i], ..., t[j] (by
+** default, 1 to #t), with all its elements in its array part.
+*/
+static int tslice (lua_State *L) {
+  lua_Integer i, j, n, m, k;
+  checktab(L, 1, TAB_R);
+  i = luaL_optinteger(L, 2, 1);
+  j = lua_isnoneornil(L, 3) ? aux_getn(L, 1, TAB_R) : luaL_checkinteger(L, 3);
+  if (i > j) {
+    lua_newtable(L);
+    return 1;
+  }
+  luaL_argcheck(L, (i > 0 || j < LUA_MAXINTEGER + i) && j - i < INT_MAX, 3,
+                   "too many elements");
+  n = j - i + 1;
+  m = 0;  /* elements up to the border of 't' */
+  if (lua_type(L, 1) == LUA_TTABLE) {
+    lua_Integer len = (lua_Integer)lua_rawlen(L, 1);
+    if (len >= i)
+      m = ((len < j) ? len : j) - i + 1;
+  }
+  lua_settop(L, 1);
+  lua_createtable(L, (int)m, 0);  /* the rest is probably nil */
+  if (m > 0 && lua_movearray(L, 1, i, i + m - 1, 2, 1))
+    k = m;  /* those elements are already copied */
+  else
+    k = 0;
+  for (; k < n; k++) {
+    lua_geti(L, 1, i + k);
+    lua_rawseti(L, 2, k + 1);
+  }
+  return 1;
+}
+
+
+/*
+** Create a table with preallocated space for 'narr' array elements and
+** 'nrec' other fields.
+*/
+static int tnew (lua_State *L) {
+  lua_Integer narr = luaL_optinteger(L, 1, 0);
+  lua_Integer nrec = luaL_optinteger(L, 2, 0);
+  luaL_argcheck(L, 0 <= narr && narr <= INT_MAX, 1, "out of range");
+  luaL_argcheck(L, 0 <= nrec && nrec <= INT_MAX, 2, "out of range");
+  lua_createtable(L, (int)narr, (int)nrec);
+  return 1;
+}
+
+
+/*
+** Remove all entries of a table, keeping its allocated space. Like
+** 'rawset', it does not call metamethods.
+*/
+static int tclear (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_cleartable(L, 1);
+  return 0;
+}
+
+
 static void addfield (lua_State *L, luaL_Buffer *b, lua_Integer i) {
   lua_geti(L, 1, i);
   if (l_unlikely(!lua_isstring(L, -1)))
@@ -418,12 +507,29 @@ static const luaL_Reg tab_funcs[] = {
   {"remove", tremove},
   {"move", tmove},
   {"sort", sort},
+  {"new", tnew},
+  {"clear", tclear},
+  {"fill", tfill},
+  {"slice", tslice},
+  {NULL, NULL}
+};
+
+
+/* functions from 'tab_funcs' that can be called as leaf functions */
+static const luaL_Reg tab_leaffuncs[] = {
+  {"new", tnew},
+  {"clear", tclear},
   {NULL, NULL}
 };
 
 
 LUAMOD_API int luaopen_table (lua_State *L) {
   luaL_newlib(L, tab_funcs);
+  luaL_setleaffuncs(L, tab_leaffuncs);
+  /* let compiled code recognize 'table.new' and 'table.clear' (see
+     'luaH_tablecall') */
+  lua_setvmfunction(L, LUA_VMF_TABLENEW, tnew);
+  lua_setvmfunction(L, LUA_VMF_TABLECLEAR, tclear);
   return 1;
 }
 
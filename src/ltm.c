@@ -235,12 +235,23 @@ int luaT_callorderiTM (lua_State *L, const TValue *p1, int v2,
 }
 
 
+/*
+** The extra arguments of a vararg function stay where the caller put
+** them, right below the function, and the function and its fixed
+** parameters are copied above them. Without extra arguments, the frame
+** already has that layout and nothing moves.
+*/
 void luaT_adjustvarargs (lua_State *L, int nfixparams, CallInfo *ci,
                          const Proto *p) {
   int i;
   int actual = cast_int(L->top - ci->func) - 1;  /* number of arguments */
   int nextra = actual - nfixparams;  /* number of extra arguments */
   ci->u.l.nextraargs = nextra;
+  if (nextra == 0) {  /* nothing to move? */
+    ci->u.l.delta = 0;
+    return;
+  }
+  ci->u.l.delta = actual + 1;
   luaD_checkstack(L, p->maxstacksize + 1);
   /* copy function to the top of the stack */
   setobjs2s(L, L->top++, ci->func);
@@ -269,3 +280,52 @@ void luaT_getvarargs (lua_State *L, CallInfo *ci, StkId where, int wanted) {
     setnilvalue(s2v(where + i));
 }
 
+
+/*
+** Fast path for a call 'f(x, ...)' whose function is in 'func', 'x' is
+** in 'func + 1' and the varargs of 'ci' would come next: if 'f' is the
+** 'select' of the base library and 'x' is "#" or a valid index, do the
+** call without copying the varargs to the stack (or copying only those
+** that 'select' returns), leaving 'nresults' results at 'func' (all of
+** them, setting 'L->top', if it is LUA_MULTRET), and return 1. Otherwise
+** return 0 and change nothing; the caller does the usual call, which
+** also raises any error.
+*/
+int luaT_selectvarargs (lua_State *L, CallInfo *ci, StkId func,
+                        int nresults) {
+  const TValue *x = s2v(func + 1);
+  int nextra = ci->u.l.nextraargs;
+  int first, n, i;
+  if (!(ttislcf(s2v(func)) &&
+        fvalue(s2v(func)) == G(L)->vmfuncs[LUA_VMF_SELECT]))
+    return 0;  /* not 'select' */
+  if (ttisstring(x) && getstr(tsvalue(x))[0] == '#') {
+    setivalue(s2v(func), nextra);
+    first = n = 1;  /* one result, already in place */
+  }
+  else if (ttisinteger(x)) {  /* same rules as 'luaB_select' */
+    lua_Integer idx = ivalue(x);
+    lua_Integer nargs = nextra + 1;  /* 'select' also gets 'x' */
+    if (idx < 0)
+      idx = nargs + idx;
+    else if (idx > nargs)
+      idx = nargs;
+    if (idx < 1)
+      return 0;  /* let 'select' raise the error */
+    first = 0;
+    n = nextra - cast_int(idx - 1);  /* results are varargs idx..nextra */
+  }
+  else
+    return 0;
+  if (nresults < 0) {
+    nresults = n;
+    checkstackGCp(L, n, func);  /* ensure stack space */
+    L->top = func + n;  /* next instruction will need top */
+  }
+  for (i = first; i < nresults && i < n; i++)
+    setobjs2s(L, func + i, ci->func - n + i);
+  for (; i < nresults; i++)  /* complete required results with nil */
+    setnilvalue(s2v(func + i));
+  return 1;
+}
+
@@ -86,6 +86,14 @@ typedef struct lua_State lua_State;
 #define LUA_RIDX_LAST		LUA_RIDX_GLOBALS
 
 
+/* library functions recognized by the VM (see 'lua_setvmfunction') */
+#define LUA_VMF_SELECT	0	/* 'select' of the base library */
+#define LUA_VMF_TABLENEW	1	/* 'table.new' of the table library */
+#define LUA_VMF_TABLECLEAR	2	/* 'table.clear' of the table library */
+#define LUA_VMF_NEXT	3	/* 'next' of the base library */
+#define LUA_NUMVMF	4
+
+
 /* type of numbers in Lua */
 typedef LUA_NUMBER lua_Number;
 
@@ -239,6 +247,7 @@ LUA_API const char *(lua_pushvfstring) (lua_State *L, const char *fmt,
                                                       va_list argp);
 LUA_API const char *(lua_pushfstring) (lua_State *L, const char *fmt, ...);
 LUA_API void  (lua_pushcclosure) (lua_State *L, lua_CFunction fn, int n);
+LUA_API void  (lua_pushleafcfunction) (lua_State *L, lua_CFunction fn);
 LUA_API void  (lua_pushboolean) (lua_State *L, int b);
 LUA_API void  (lua_pushlightuserdata) (lua_State *L, void *p);
 LUA_API int   (lua_pushthread) (lua_State *L);
@@ -338,6 +347,11 @@ LUA_API int (lua_gc) (lua_State *L, int what, ...);
 LUA_API int   (lua_error) (lua_State *L);
 
 LUA_API int   (lua_next) (lua_State *L, int idx);
+LUA_API void  (lua_cleartable) (lua_State *L, int idx);
+LUA_API int   (lua_movearray) (lua_State *L, int src, lua_Integer f,
+                               lua_Integer e, int dst, lua_Integer t);
+LUA_API int   (lua_fillarray) (lua_State *L, int idx, int vidx,
+                               lua_Integer i, lua_Integer j);
 
 LUA_API void  (lua_concat) (lua_State *L, int n);
 LUA_API void  (lua_len)    (lua_State *L, int idx);
@@ -350,6 +364,8 @@ LUA_API void      (lua_setallocf) (lua_State *L, lua_Alloc f, void *ud);
 LUA_API void (lua_toclose) (lua_State *L, int idx);
 LUA_API void (lua_closeslot) (lua_State *L, int idx);
 
+LUA_API void (lua_setvmfunction) (lua_State *L, int id, lua_CFunction f);
+
 
 /*
 ** {==============================================================
@@ -459,11 +475,23 @@ LUA_API const char *(lua_setupvalue) (lua_State *L, int funcindex, int n);
 LUA_API void *(lua_upvalueid) (lua_State *L, int fidx, int n);
 LUA_API void  (lua_upvaluejoin) (lua_State *L, int fidx1, int n1,
                                                int fidx2, int n2);
+LUA_API int (lua_getaotguard) (lua_State *L, int fidx, int n, int *pc,
+                                             int *line, unsigned int *failures);
+LUA_API int (lua_getinlinecache) (lua_State *L, int fidx, int n, int *pc,
+                                  int *line, unsigned int *hits,
+                                  unsigned int *misses);
+LUA_API int (lua_lenstats) (lua_State *L, lua_Unsigned *hits,
+                                          lua_Unsigned *searches, int reset);
+LUA_API unsigned int (lua_gethashstats) (lua_State *L, int idx,
+                                         unsigned int *nkeys,
+                                         lua_Unsigned *probes,
+                                         unsigned int *maxprobes);
 
 LUA_API void (lua_sethook) (lua_State *L, lua_Hook func, int mask, int count);
 LUA_API lua_Hook (lua_gethook) (lua_State *L);
 LUA_API int (lua_gethookmask) (lua_State *L);
 LUA_API int (lua_gethookcount) (lua_State *L);
+LUA_API int (lua_opstats) (lua_State *L, int reset);
 
 LUA_API int (lua_setcstacklimit) (lua_State *L, unsigned int limit);
 
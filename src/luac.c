@@ -368,6 +368,7 @@ static void PrintCode(const Proto* f)
   switch (o)
   {
    case OP_MOVE:
+   case OP_MOVECALL:
 	printf("%d %d",a,b);
 	break;
    case OP_LOADI:
@@ -398,6 +399,7 @@ static void PrintCode(const Proto* f)
 	printf(COMMENT "%d out",b+1);
 	break;
    case OP_GETUPVAL:
+   case OP_GETUPVALMOVE:
 	printf("%d %d",a,b);
 	printf(COMMENT "%s",UPVALNAME(b));
 	break;
@@ -417,6 +419,7 @@ static void PrintCode(const Proto* f)
 	printf("%d %d %d",a,b,c);
 	break;
    case OP_GETFIELD:
+   case OP_GETFIELD2:
 	printf("%d %d %d",a,b,c);
 	printf(COMMENT); PrintConstant(f,c);
 	break;
@@ -435,6 +438,7 @@ static void PrintCode(const Proto* f)
 	if (isk) { printf(COMMENT); PrintConstant(f,c); }
 	break;
    case OP_SETFIELD:
+   case OP_SETFIELDGET:
 	printf("%d %d %d%s",a,b,c,ISK);
 	printf(COMMENT); PrintConstant(f,b);
 	if (isk) { printf(" "); PrintConstant(f,c); }
@@ -737,6 +737,106 @@
 #endif
 
 
+/*
+@@ LUA_USE_MMAPSTACK makes each thread reserve, when it is created, the
+** address space for the largest stack it may need (about LUAI_MAXSTACK
+** slots) with 'mmap'. The system commits pages only when they are used,
+** so stacks grow in place and never move. This avoids copying the stack
+** and correcting the pointers into it, and the interpreter does not need
+** to reload 'base' after the stack grows.
+** It needs a POSIX system with anonymous mappings. The memory used by the
+** stacks does not go through the allocator function, so the garbage
+** collector does not count it.
+** Each thread, including each coroutine and each dead thread kept for
+** reuse, reserves its own (LUAI_MAXSTACK + 200 + EXTRA_STACK) stack
+** slots, about 16 MB of address space with the default values. So a
+** 32-bit system runs out of address space after a few hundred threads,
+** and a 64-bit one after a few million (the default build has no such
+** limit). With strict overcommit accounting ('vm.overcommit_memory=2'
+** on Linux), the whole reservation counts as committed memory. Creating
+** a thread then fails with a memory error. Lower LUAI_MAXSTACK to reduce
+** the reservation of each thread.
+** Define it when compiling (e.g., 'make linux MYCFLAGS=-DLUA_USE_MMAPSTACK'),
+** as 'lprefix.h' also needs it.
+*/
+
+
+/*
+@@ LUAI_SWISSTABLE replaces the chained scatter table used for the hash
+** part of tables with an open-addressing table in the style of Swiss
+** tables: an array of control bytes, with a 7-bit tag of each key's
+** hash, is scanned a group of 16 nodes at a time (with SSE2, when
+** available), and keys are compared only in the nodes whose tags match.
+** It adds fields to 'Table' before those of LUAI_SHAPES and
+** LUAI_TYPEDARRAY, so modules compiled with either of those options
+** must also be built with the same setting of this one. Otherwise,
+** compiled modules do not depend on it.
+*/
+/* #define LUAI_SWISSTABLE */
+
+
+/*
+@@ LUAI_SHAPES stores the string fields of small record-like tables in
+** a flat array of slots, whose keys are kept in a shape shared by all
+** tables that received the same keys in the same order. A table goes
+** back to a regular hash part when it gets a key that is not a short
+** string, or more fields than a shape can hold. Compiled modules must
+** be built with the same option, because their inline caches look at
+** the slots.
+*/
+/* #define LUAI_SHAPES */
+
+
+/*
+@@ LUAI_TYPEDARRAY lets the array part of a table whose elements are all
+** floats, or all integers, keep only their values, without tags, in
+** half the memory. It goes back to regular values when it gets a value
+** of another type. It needs 64-bit integers and doubles. Compiled
+** modules must be built with the same option.
+*/
+/* #define LUAI_TYPEDARRAY */
+
+
+/*
+@@ LUAI_INCREHASH makes a large hash part grow incrementally: instead of
+** reinserting all its keys at once, the table keeps its old node array
+** and moves a few of its nodes to the new one on each new key, while
+** lookups search both arrays. This bounds the pause of an insertion into
+** a huge table. It has no effect with LUAI_SWISSTABLE. Compiled modules
+** do not depend on this option.
+*/
+/* #define LUAI_INCREHASH */
+
+
+/*
+@@ LUAI_CACHESTATS makes the inline caches of the interpreter count their
+** hits, besides their misses, for 'debug.getcachestats'. Counting every
+** hit costs a memory write on each cached field access, so it is off by
+** default.
+*/
+/* #define LUAI_CACHESTATS */
+
+
+/*
+@@ LUAI_LENSTATS makes table lengths count all their calls, besides the
+** ones that had to search for a border, so that 'debug.lenstats' also
+** reports the lengths found without a search. Counting every length
+** costs a memory write on each '#t', so it is off by default.
+*/
+/* #define LUAI_LENSTATS */
+
+
+/*
+@@ LUAI_OPCOUNT makes the interpreter count how many times it executes
+** each opcode, each pair of consecutive opcodes and each instruction of
+** each function, for 'debug.opstats' (and 'scripts/opstats.lua'). Code
+** compiled ahead of time is not counted. It costs a few memory writes
+** per instruction, so it is off by default. Modules generated by 'luaot'
+** do not need to be compiled with it.
+*/
+/* #define LUAI_OPCOUNT */
+
+
 /*
 @@ LUA_EXTRASPACE defines the size of a raw memory area associated with
 ** a Lua state with very fast access.
@@ -35,25 +35,41 @@ static char *input_filename  = NULL;
 static char *output_filename = NULL;
 static char *module_name     = NULL;
 
+static char **input_filenames = NULL;
+static int ninputs = 0;
+
 static FILE * output_file = NULL;
 static int nfunctions = 0;
 static TString **tmname;
 
 int executable = 0;
 int use_winmain = 0;
+int static_executable = 0;
+
+// Speculation: sites listed in the --deopt file always use the generic code
+static int use_speculation = 1;
+static int ndeopts = 0;
+static int *deopt_lines = NULL;
+static int *deopt_pcs = NULL;
 
 static
 void usage()
 {
     fprintf(stderr,
           "usage: %s [options] [filename]\n"
+          "       %s --exe [options] main.lua [module.lua ...]\n"
           "Available options are:\n"
           "  -o name            output to file 'name'\n"
           "  -m name            generate code with `name` function as main function\n"
           "  -s                 use  switches instead of gotos in generated code\n"
           "  -e                 add a main symbol for executables\n"
-          "  -w                 add a WinMain symbol for consoleless executables on windows\n",
-          program_name);
+          "  -w                 add a WinMain symbol for consoleless executables on windows\n"
+          "  --exe              bundle the main script and all the given modules into\n"
+          "                     a single executable, with every module preloaded\n"
+          "  --no-speculation   do not generate speculative code with guards\n"
+          "  --deopt file       do not speculate at the sites listed in 'file', one\n"
+          "                     \"linedefined pc\" pair per line\n",
+          program_name, program_name);
 }
 
 static
@@ -92,6 +108,38 @@ void printnl()
 }
 
 
+static
+void read_deopt_file(const char *filename)
+{
+    FILE *f = fopen(filename, "r");
+    if (f == NULL) {
+        fprintf(stderr, "%s: cannot open %s: %s\n", program_name, filename, strerror(errno));
+        exit(1);
+    }
+    int cap = 16;
+    deopt_lines = (int *) malloc(cap * sizeof(int));
+    deopt_pcs   = (int *) malloc(cap * sizeof(int));
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        int linedefined, pc;
+        if (line[strspn(line, " \t")] == '#') {
+            continue; // comment
+        }
+        if (sscanf(line, "%d %d", &linedefined, &pc) != 2) {
+            continue; // blank or malformed line
+        }
+        if (ndeopts == cap) {
+            cap *= 2;
+            deopt_lines = (int *) realloc(deopt_lines, cap * sizeof(int));
+            deopt_pcs   = (int *) realloc(deopt_pcs,   cap * sizeof(int));
+        }
+        deopt_lines[ndeopts] = linedefined;
+        deopt_pcs[ndeopts] = pc;
+        ndeopts++;
+    }
+    fclose(f);
+}
+
 static void doargs(int argc, char **argv)
 {
     // I wonder if I should just use getopt instead of parsing options by hand
@@ -99,6 +147,7 @@ static void doargs(int argc, char **argv)
 
     int do_opts = 1;
     int npos = 0;
+    input_filenames = (char **) malloc(argc * sizeof(char *));
     for (int i = 1; i < argc; i++) {
         char *arg = argv[i];
         if (do_opts && arg[0] == '-') {
@@ -116,6 +165,15 @@ static void doargs(int argc, char **argv)
             } else if (0 == strcmp(arg, "-w")) {
                 executable = 1;
                 use_winmain = 1;
+            } else if (0 == strcmp(arg, "--exe")) {
+                executable = 1;
+                static_executable = 1;
+            } else if (0 == strcmp(arg, "--no-speculation")) {
+                use_speculation = 0;
+            } else if (0 == strcmp(arg, "--deopt")) {
+                i++;
+                if (i >= argc) { fatal_error("missing argument for --deopt"); }
+                read_deopt_file(argv[i]);
             } else if (0 == strcmp(arg, "-o")) {
                 i++;
                 if (i >= argc) { fatal_error("missing argument for -o"); }
@@ -125,29 +183,69 @@ static void doargs(int argc, char **argv)
                 exit(1);
             }
         } else {
-            switch (npos) {
-                case 0:
-                    input_filename = arg;
-                    break;
-                default:
-                    fatal_error("too many positional arguments");
-                    break;
-            }
-            npos++;
+            input_filenames[npos++] = arg;
         }
     }
 
+    if (npos > 1 && !static_executable) {
+        fatal_error("too many positional arguments");
+    }
+    input_filename = (npos > 0) ? input_filenames[0] : NULL;
+    ninputs = npos;
+
     if (output_filename == NULL) {
         usage();
         exit(1);
     }
 }
 
-static char *get_module_name_from_filename(const char *);
+static char *get_module_name_from_filename(const char *, const char *);
 static void check_module_name(const char *);
 static void replace_dots(char *);
-static void print_functions();
-static void print_source_code();
+static void unfuse_superinstructions(Proto *);
+static void print_functions(Proto *, int);
+static void print_source_code(const char *);
+static void print_main();
+
+// In --exe mode, the C names of the modules that go in package.preload
+static char **preload_names = NULL;
+static char **preload_cnames = NULL;
+
+static
+void print_module(lua_State *L, const char *filename, const char *name, const char *cname)
+{
+    if (luaL_loadfile(L, filename) != LUA_OK) {
+        fatal_error(lua_tostring(L,-1));
+    }
+    Proto *proto = getproto(s2v(L->top-1));
+    unfuse_superinstructions(proto);
+
+    // Each module gets its own function table and source code array, so that
+    // several of them can share the same output file.
+    println("#undef  LUAOT_FUNCTIONS");
+    println("#define LUAOT_FUNCTIONS LUAOT_FUNCTIONS_%s", cname);
+    println("#undef  LUAOT_GUARDS");
+    println("#define LUAOT_GUARDS LUAOT_GUARDS_%s", cname);
+    println("#undef  LUAOT_MODULE_SOURCE_CODE");
+    println("#define LUAOT_MODULE_SOURCE_CODE LUAOT_MODULE_SOURCE_CODE_%s", cname);
+    printnl();
+    print_functions(proto, nfunctions);
+    printnl();
+    print_source_code(filename);
+    printnl();
+    println("#undef  LUAOT_MODULE_NAME");
+    println("#define LUAOT_MODULE_NAME \"%s\"", name);
+    println("#undef  LUAOT_LUAOPEN_NAME");
+    println("#define LUAOT_LUAOPEN_NAME luaopen_%s", cname);
+    printnl();
+    #if defined(LUAOT_USE_GOTOS)
+    println("#include \"luaot_footer.c\"");
+    #elif defined(LUAOT_USE_SWITCHES)
+    println("#include \"trampoline_footer.c\"");
+    #endif
+
+    lua_pop(L, 1);
+}
 
 int main(int argc, char **argv)
 {
@@ -156,22 +254,34 @@ int main(int argc, char **argv)
     doargs(argc, argv);
 
     if (!module_name) {
-        module_name = get_module_name_from_filename(output_filename);
+        if (static_executable) {
+            module_name = get_module_name_from_filename(input_filename, ".lua");
+        } else {
+            module_name = get_module_name_from_filename(output_filename, ".c");
+        }
     }
     check_module_name(module_name);
     replace_dots(module_name);
 
-    // Read the input
-
-    lua_State *L = luaL_newstate();
-    if (luaL_loadfile(L, input_filename) != LUA_OK) {
-        fatal_error(lua_tostring(L,-1));
+    // The other modules of an executable are named after their paths, the
+    // same way that `require` would find them from the current directory.
+    preload_names  = (char **) malloc(ninputs * sizeof(char *));
+    preload_cnames = (char **) malloc(ninputs * sizeof(char *));
+    for (int m = 1; m < ninputs; m++) {
+        preload_names[m] = get_module_name_from_filename(input_filenames[m], ".lua");
+        check_module_name(preload_names[m]);
+        if (preload_names[m][0] == '.') {
+            fatal_error("modules must be inside the current directory");
+        }
+        preload_cnames[m] = strdup(preload_names[m]);
+        replace_dots(preload_cnames[m]);
     }
-    Proto *proto = getproto(s2v(L->top-1));
-    tmname = G(L)->tmname;
 
     // Generate the file
 
+    lua_State *L = luaL_newstate();
+    tmname = G(L)->tmname;
+
     output_file = fopen(output_filename, "w");
     if (output_file == NULL) { fatal_error(strerror(errno)); }
 
@@ -181,42 +291,66 @@ int main(int argc, char **argv)
     println("#include \"trampoline_header.c\"");
     #endif
     printnl();
-    print_functions(proto);
-    printnl();
-    print_source_code();
+    print_module(L, input_filename, module_name, module_name);
+    for (int m = 1; m < ninputs; m++) {
+        printnl();
+        print_module(L, input_filenames[m], preload_names[m], preload_cnames[m]);
+    }
+    if (executable) {
+        print_main();
+    }
+
+    return 0;
+}
+
+static
+void print_main()
+{
     printnl();
-    println("#define LUAOT_MODULE_NAME \"%s\"", module_name);
-    println("#define LUAOT_LUAOPEN_NAME luaopen_%s", module_name);
     printnl();
-    #if defined(LUAOT_USE_GOTOS)
-    println("#include \"luaot_footer.c\"");
-    #elif defined(LUAOT_USE_SWITCHES)
-    println("#include \"trampoline_footer.c\"");
-    #endif
-    if (executable) {
-      printnl();
-      printnl();
-      println("int main(int argc, char *argv[]) {");
-      println(" lua_State *L = luaL_newstate();");
-      println(" luaL_openlibs(L);");
-      println(" int i;");
-      println(" lua_createtable(L, argc + 1, 0);");
-      println(" for (i = 0; i < argc; i++) {");
-      println("   lua_pushstring(L, argv[i]);");
-      println("   lua_rawseti(L, -2, i);");
-      println(" }");
-      println(" lua_setglobal(L, \"arg\");");
-      println(" lua_pushcfunction(L, LUAOT_LUAOPEN_NAME);");
-      println("i = lua_pcall(L, 0, 0, 0);");
-      println(" if (i != LUA_OK) {");
-      println("   fprintf(stderr, \"%%s\\n\", lua_tostring(L, -1));");
-      println("   return 1;");
-      println(" }");
-      println("lua_close(L);");
-      println(" return 0;");
-      println("}");
-
-      if (use_winmain) {
+    println("int main(int argc, char *argv[]) {");
+    println(" lua_State *L = luaL_newstate();");
+    println(" luaL_openlibs(L);");
+    println(" int i;");
+    println(" lua_createtable(L, argc + 1, 0);");
+    println(" for (i = 0; i < argc; i++) {");
+    println("   lua_pushstring(L, argv[i]);");
+    println("   lua_rawseti(L, -2, i);");
+    println(" }");
+    println(" lua_setglobal(L, \"arg\");");
+    if (static_executable) {
+        println(" /* every module is preloaded... */");
+        println(" luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_PRELOAD_TABLE);");
+        for (int m = 1; m < ninputs; m++) {
+            println(" lua_pushcfunction(L, luaopen_%s);", preload_cnames[m]);
+            println(" lua_setfield(L, -2, \"%s\");", preload_names[m]);
+        }
+        println(" lua_pop(L, 1);");
+        println(" /* ...so 'require' should never search the file system */");
+        println(" lua_getglobal(L, LUA_LOADLIBNAME);");
+        println(" lua_getfield(L, -1, \"searchers\");");
+        println(" for (i = (int)luaL_len(L, -1); i > 1; i--) {");
+        println("   lua_pushnil(L);  /* keep only the preload searcher */");
+        println("   lua_rawseti(L, -2, i);");
+        println(" }");
+        println(" lua_pop(L, 1);");
+        println(" lua_pushliteral(L, \"\");");
+        println(" lua_setfield(L, -2, \"path\");");
+        println(" lua_pushliteral(L, \"\");");
+        println(" lua_setfield(L, -2, \"cpath\");");
+        println(" lua_pop(L, 1);");
+    }
+    println(" lua_pushcfunction(L, luaopen_%s);", module_name);
+    println("i = lua_pcall(L, 0, 0, 0);");
+    println(" if (i != LUA_OK) {");
+    println("   fprintf(stderr, \"%%s\\n\", lua_tostring(L, -1));");
+    println("   return 1;");
+    println(" }");
+    println("lua_close(L);");
+    println(" return 0;");
+    println("}");
+
+    if (use_winmain) {
         printnl();
         printnl();
         println("#ifdef _WIN32");
@@ -225,17 +359,18 @@ int main(int argc, char **argv)
         println("  return main(__argc, __argv);");
         println("}");
         println("#endif");
-      }
     }
-
-    return 0;
 }
 
 // Deduce the Lua module name given the file name
 // Example:  ./foo/bar/baz.c -> foo.bar.baz
 static
-char *get_module_name_from_filename(const char *filename)
+char *get_module_name_from_filename(const char *filename, const char *ext)
 {
+    while (filename[0] == '.' && filename[1] == '/') {
+        filename += 2;
+    }
+
     size_t n = strlen(filename);
 
     int has_extension = 0;
@@ -247,11 +382,12 @@ char *get_module_name_from_filename(const char *filename)
         }
     }
 
-    if (!has_extension || 0 != strcmp(filename + sep, ".c")) {
-        fatal_error("output file does not have a \".c\" extension");
+    if (!has_extension || 0 != strcmp(filename + sep, ext)) {
+        fprintf(stderr, "%s: %s does not have a \"%s\" extension\n", program_name, filename, ext);
+        exit(1);
     }
 
-    char *module_name = malloc(sep+1);
+    char *module_name = (char *) malloc(sep+1);
     for (size_t i = 0; i < sep; i++) {
         int c = filename[i];
         if (c == '/') {
@@ -447,6 +583,7 @@ void luaot_PrintOpcodeComment(Proto *f, int pc)
     print("%-9s\t", opnames[o]);
     switch (o) {
         case OP_MOVE:
+        case OP_MOVECALL:
             print("%d %d",a,b);
             break;
         case OP_LOADI:
@@ -477,6 +614,7 @@ void luaot_PrintOpcodeComment(Proto *f, int pc)
             print(COMMENT "%d out",b+1);
             break;
         case OP_GETUPVAL:
+        case OP_GETUPVALMOVE:
             print("%d %d",a,b);
             print(COMMENT "%s", UPVALNAME(b));
             break;
@@ -496,6 +634,7 @@ void luaot_PrintOpcodeComment(Proto *f, int pc)
             print("%d %d %d",a,b,c);
             break;
         case OP_GETFIELD:
+        case OP_GETFIELD2:
             print("%d %d %d",a,b,c);
             print(COMMENT); PrintConstant(f,c);
             break;
@@ -514,6 +653,7 @@ void luaot_PrintOpcodeComment(Proto *f, int pc)
             if (isk) { print(COMMENT); PrintConstant(f,c); }
             break;
         case OP_SETFIELD:
+        case OP_SETFIELDGET:
             print("%d %d %d%s",a,b,c,ISK);
             print(COMMENT); PrintConstant(f,b);
             if (isk) { print(" "); PrintConstant(f,c); }
@@ -751,6 +891,260 @@ void luaot_PrintOpcodeComment(Proto *f, int pc)
     print("\n");
 }
 
+//
+// Static analysis
+// ---------------
+//
+// Conservative facts about the bytecode, for the specialized opcodes.
+//
+
+// The parser fuses some frequent pairs of instructions into superinstructions
+// (see lopcodes.h). They only spare the interpreter a dispatch, which the
+// compiled code does not have anyway, so we compile the original pairs.
+static
+void unfuse_superinstructions(Proto *f)
+{
+    for (int pc = 0; pc < f->sizecode; pc++) {
+        OpCode op = GET_OPCODE(f->code[pc]);
+        SET_OPCODE(f->code[pc], unfusedop(op));
+    }
+    for (int i = 0; i < f->sizep; i++) {
+        unfuse_superinstructions(f->p[i]);
+    }
+}
+
+// Marks every instruction that may be reached by something other than
+// falling through from the previous instruction. The caller frees it.
+static
+char *find_jump_targets(Proto *f)
+{
+    char *targets = (char *) calloc(f->sizecode + 2, 1);
+    for (int pc = 0; pc < f->sizecode; pc++) {
+        Instruction instr = f->code[pc];
+        OpCode op = GET_OPCODE(instr);
+        switch (op) {
+            case OP_JMP:
+                targets[(pc+1) + GETARG_sJ(instr)] = 1;
+                break;
+            case OP_FORLOOP:
+            case OP_TFORLOOP:
+                targets[(pc+1) - GETARG_Bx(instr)] = 1;
+                break;
+            case OP_FORPREP:
+                targets[(pc+1) + GETARG_Bx(instr) + 1] = 1;
+                break;
+            case OP_TFORPREP:
+                targets[(pc+1) + GETARG_Bx(instr)] = 1;
+                break;
+            default:
+                // Tests, arithmetic (skipping OP_MMBIN) and instructions
+                // with an OP_EXTRAARG may skip the next instruction.
+                if (testTMode(op) || op == OP_LFALSESKIP ||
+                    (OP_ADDI <= op && op <= OP_SHR) ||
+                    op == OP_LOADKX || op == OP_NEWTABLE || op == OP_SETLIST) {
+                    targets[pc + 2] = 1;
+                }
+                break;
+        }
+    }
+    return targets;
+}
+
+// Does the instruction leave every register up to 'reg' untouched?
+static
+int preserves_register(Instruction instr, int reg)
+{
+    switch (GET_OPCODE(instr)) {
+        case OP_SETUPVAL: case OP_SETTABUP: case OP_SETTABLE:
+        case OP_SETI: case OP_SETFIELD:
+        case OP_MMBIN: case OP_MMBINI: case OP_MMBINK:
+        case OP_EXTRAARG:
+            // No register writes (OP_MMBIN writes the register of the
+            // arithmetic instruction that precedes it).
+            return 1;
+        case OP_MOVE: case OP_LOADI: case OP_LOADF: case OP_LOADK:
+        case OP_LOADKX: case OP_LOADFALSE: case OP_LOADTRUE: case OP_LOADNIL:
+        case OP_GETUPVAL: case OP_GETTABUP: case OP_GETTABLE: case OP_GETI:
+        case OP_GETFIELD: case OP_NEWTABLE: case OP_SELF:
+        case OP_ADDI: case OP_ADDK: case OP_SUBK: case OP_MULK: case OP_MODK:
+        case OP_POWK: case OP_DIVK: case OP_IDIVK: case OP_BANDK: case OP_BORK:
+        case OP_BXORK: case OP_SHRI: case OP_SHLI: case OP_ADD: case OP_SUB:
+        case OP_MUL: case OP_MOD: case OP_POW: case OP_DIV: case OP_IDIV:
+        case OP_BAND: case OP_BOR: case OP_BXOR: case OP_SHL: case OP_SHR:
+        case OP_UNM: case OP_BNOT: case OP_NOT: case OP_LEN: case OP_CONCAT:
+        case OP_CALL: case OP_CLOSURE: case OP_VARARG:
+            // These only write to R[A] and above.
+            return GETARG_A(instr) > reg;
+        default:
+            return 0;
+    }
+}
+
+// Is the OP_VARARG at 'pc' the last argument of a call 'f(x, ...)' in the
+// next instruction? If 'f' turns out to be select, luaT_selectvarargs can do
+// the whole call, with the number of results returned by select_nresults.
+static
+int is_select_vararg(Proto *f, int pc)
+{
+    Instruction instr = f->code[pc];
+    if (GETARG_C(instr) != 0 || pc + 2 >= f->sizecode) return 0;
+    Instruction call = f->code[pc + 1];
+    return (GET_OPCODE(call) == OP_CALL || GET_OPCODE(call) == OP_TAILCALL) &&
+           GETARG_B(call) == 0 && GETARG_A(call) + 2 == GETARG_A(instr);
+}
+
+static
+int select_nresults(Proto *f, int pc)
+{
+    Instruction call = f->code[pc + 1];
+    // A tail call is done as a call with all results, which the OP_RETURN
+    // after it returns.
+    return GET_OPCODE(call) == OP_CALL ? GETARG_C(call) - 1 : LUA_MULTRET;
+}
+
+// Does the OP_CALL at 'pc' look like 't.new(...)' or 't.clear(...)', with a
+// fixed number of arguments and of results? If the function turns out to be
+// table.new or table.clear, luaH_tablecall can do the whole call. We only
+// look inside the straight-line code before 'pc', up to a jump target in
+// 'targets' (from find_jump_targets).
+static
+int is_table_call(Proto *f, const char *targets, int pc)
+{
+    Instruction call = f->code[pc];
+    int reg = GETARG_A(call);
+    if (GETARG_B(call) == 0 || GETARG_C(call) == 0) return 0;
+    int res = 0;
+    for (int k = pc - 1; k >= 0 && !targets[k + 1]; k--) {
+        Instruction instr = f->code[k];
+        if (GET_OPCODE(instr) == OP_GETFIELD && GETARG_A(instr) == reg) {
+            const char *key = getstr(tsvalue(&f->k[GETARG_C(instr)]));
+            res = (strcmp(key, "new") == 0 || strcmp(key, "clear") == 0);
+            break;
+        }
+        if (!preserves_register(instr, reg)) {
+            break;
+        }
+    }
+    return res;
+}
+
+//
+// Speculation
+// -----------
+//
+// Some instructions get a speculative version, which assumes something that
+// usually holds at that site and checks it with a cheap guard. A failed
+// guard bumps its failure counter, which debug.getaotstats reports, and
+// jumps to the generic version of the same instruction. Sites that fail too
+// often can be listed in a --deopt file for the next compilation.
+//
+// For now the only speculation is on field slots: an OP_GETFIELD, OP_SELF
+// or OP_GETTABUP with a short string key remembers the node where it last
+// found the key, and tries that node before hashing the key.
+
+static int *nguards = NULL; // number of guards of each function, by id
+static int sizenguards = 0;
+
+static
+int is_deoptimized(Proto *f, int pc)
+{
+    for (int j = 0; j < ndeopts; j++) {
+        if (deopt_lines[j] == f->linedefined && deopt_pcs[j] == pc) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Should the instruction at 'pc' get a speculative version?
+static
+int has_guard(Proto *f, int pc)
+{
+    if (!use_speculation || is_deoptimized(f, pc)) {
+        return 0;
+    }
+    Instruction instr = f->code[pc];
+    switch (GET_OPCODE(instr)) {
+        case OP_GETFIELD:
+        case OP_GETTABUP:
+            return 1; // the key is always a short string constant
+        case OP_SELF:
+            return GETARG_k(instr) && ttisshrstring(&f->k[GETARG_C(instr)]);
+        default:
+            return 0;
+    }
+}
+
+// Prints the guard table and the slot caches of a function, and returns an
+// array mapping each pc to its guard number (or -1). The caller frees it.
+static
+int *print_guards(Proto *f, int func_id)
+{
+    int *guard_of = (int *) malloc(f->sizecode * sizeof(int));
+    int n = 0;
+    for (int pc = 0; pc < f->sizecode; pc++) {
+        guard_of[pc] = has_guard(f, pc) ? n++ : -1;
+    }
+
+    if (func_id >= sizenguards) {
+        sizenguards = 2 * func_id + 16;
+        nguards = (int *) realloc(nguards, sizenguards * sizeof(int));
+    }
+    nguards[func_id] = n;
+
+    if (n > 0) {
+        println("static AotGuard luaot_guards_%02d[] = {", func_id);
+        for (int pc = 0; pc < f->sizecode; pc++) {
+            if (guard_of[pc] >= 0) {
+                println("  { %d, 0 },", pc);
+            }
+        }
+        println("};");
+        for (int pc = 0; pc < f->sizecode; pc++) {
+            if (guard_of[pc] >= 0) {
+                println("static AotSlotCache luaot_slot_%02d_%02d;", func_id, pc);
+            }
+        }
+        printnl();
+    }
+    return guard_of;
+}
+
+// Prints the speculative version of the instruction at 'pc'. On success, it
+// continues with the instruction given by 'next' (a statement); on failure,
+// it jumps to the label 'generic_<pc>'. The indentation is 'ind'.
+static
+void println_speculation(Proto *f, int func_id, int pc, int g, const char *ind, const char *next)
+{
+    Instruction instr = f->code[pc];
+    println("%sconst TValue *slot;", ind);
+    switch (GET_OPCODE(instr)) {
+        case OP_GETFIELD:
+            println("%sTValue *rb = vRB(i);", ind);
+            println("%sTString *key = tsvalue(KC(i));", ind);
+            break;
+        case OP_GETTABUP:
+            println("%sTValue *rb = cl->upvals[GETARG_B(i)]->v;", ind);
+            println("%sTString *key = tsvalue(KC(i));", ind);
+            break;
+        case OP_SELF:
+            println("%sTValue *rb = vRB(i);", ind);
+            println("%sTString *key = tsvalue(KC(i));", ind);
+            break;
+        default:
+            fatal_error("instruction has no speculative version");
+    }
+    println("%sif (l_unlikely(!aot_slotcheck(luaot_slot_%02d_%02d, rb, key, slot))) {", ind, func_id, pc);
+    println("%s  aot_guardfailed(luaot_guards_%02d[%d]);", ind, func_id, g);
+    println("%s  goto generic_%02d;", ind, pc);
+    println("%s}", ind);
+    if (GET_OPCODE(instr) == OP_SELF) {
+        println("%ssetobj2s(L, ra + 1, rb);", ind);
+    }
+    println("%ssetobj2s(L, ra, slot);", ind);
+    println("%s%s", ind, next);
+}
+
 #if defined(LUAOT_USE_GOTOS)
 #include "luaot_gotos.c"
 #elif defined(LUAOT_USE_SWITCHES)
@@ -770,20 +1164,31 @@ void create_functions(Proto *p)
 }
 
 static
-void print_functions(Proto *p)
+void print_functions(Proto *p, int first)
 {
     create_functions(p);
 
     println("static AotCompiledFunction LUAOT_FUNCTIONS[] = {");
-    for (int i = 0; i < nfunctions; i++) {
+    for (int i = first; i < nfunctions; i++) {
         println("  magic_implementation_%02d,", i);
     }
     println("  NULL");
     println("};");
+    printnl();
+    println("static AotGuardList LUAOT_GUARDS[] = {");
+    for (int i = first; i < nfunctions; i++) {
+        if (nguards[i] > 0) {
+            println("  { luaot_guards_%02d, %d },", i, nguards[i]);
+        } else {
+            println("  { NULL, 0 },");
+        }
+    }
+    println("  { NULL, 0 }");
+    println("};");
 }
 
 static
-void print_source_code()
+void print_source_code(const char *filename)
 {
     // Since the code we are generating is lifted from lvm.c, we need it to use
     // Lua functions instead of C functions. And to create the Lua functions,
@@ -794,7 +1199,7 @@ void print_source_code()
     // string literal can be, so instead of using a string literal, we use a
     // plain char array instead.
 
-    FILE *infile = fopen(input_filename, "r");
+    FILE *infile = fopen(filename, "r");
     if (!infile) { fatal_error("could not open input file a second time"); }
 
     println("static const char LUAOT_MODULE_SOURCE_CODE[] = {");
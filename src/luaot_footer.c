@@ -1,18 +1,27 @@
+#ifndef LUAOT_FOOTER_ONCE
+#define LUAOT_FOOTER_ONCE
+
 #include "lauxlib.h"
 #include "lualib.h"
 
-static int next_id = 0;
-
 static
-void bind_magic(Proto *f)
+void bind_magic(Proto *f, AotCompiledFunction *functions, AotGuardList *guards, int *next_id)
 {
     // This traversal order should be the same one that luaot.c uses
-    f->aot_implementation = LUAOT_FUNCTIONS[next_id++];
+    f->aot_guards = guards[*next_id].guards;
+    f->sizeaot_guards = guards[*next_id].size;
+    f->aot_implementation = functions[(*next_id)++];
     for(int i=0; i < f->sizep; i++) {
-        bind_magic(f->p[i]);
+        bind_magic(f->p[i], functions, guards, next_id);
     }
 }
 
+#endif
+
+// A Lua core built as C++ (for C++ exceptions) looks for an unmangled name
+#ifdef __cplusplus
+extern "C"
+#endif
 int LUAOT_LUAOPEN_NAME(lua_State *L) {
     int ok = luaL_loadbuffer(L, LUAOT_MODULE_SOURCE_CODE, sizeof(LUAOT_MODULE_SOURCE_CODE)-1, "AOT Compiled module \""LUAOT_MODULE_NAME"\"");
     switch (ok) {
@@ -32,8 +41,9 @@ int LUAOT_LUAOPEN_NAME(lua_State *L) {
         exit(1);
     }
 
-    LClosure *cl = (void *) lua_topointer(L, -1);
-    bind_magic(cl->p);
+    int next_id = 0;
+    LClosure *cl = (LClosure *) lua_topointer(L, -1);
+    bind_magic(cl->p, LUAOT_FUNCTIONS, LUAOT_GUARDS, &next_id);
 
     lua_call(L, 0, 1);
     return 1;
@@ -27,6 +27,56 @@ void println_goto_ret()
     println("    }");
 }
 
+static
+void println_closure(Proto *f, int bx)
+{
+    // Unrolled version of pushclosure, using the upvalue descriptors of the
+    // nested prototype, which are known at compile time. A prototype whose
+    // upvalues all come from the enclosing function does not capture any
+    // local variable, so we can reuse the last closure created for it as
+    // long as it still points to the same upvalues. (Such a closure may
+    // still have upvalues; they are shared with the enclosing function.)
+    // The GC clears 'p->cache' when nothing else keeps the closure alive.
+    Proto *p = f->p[bx];
+    int nup = p->sizeupvalues;
+    int cacheable = 1;
+    for (int j = 0; j < nup; j++) {
+        if (p->upvalues[j].instack) { cacheable = 0; }
+    }
+
+    println("    Proto *p = cl->p->p[%d];", bx);
+    println("    LClosure *ncl;");
+    println("    savestate(L, ci);  /* in case of allocation errors */");
+    if (cacheable) {
+        print("    if ((ncl = p->cache) != NULL");
+        for (int j = 0; j < nup; j++) {
+            print(" &&\n        ncl->upvals[%d] == cl->upvals[%d]", j, p->upvalues[j].idx);
+        }
+        println(") {");
+        println("      setclLvalue2s(L, ra, ncl);  /* reuse cached closure */");
+        println("    }");
+        println("    else {");
+    } else {
+        println("    {");
+    }
+    println("      ncl = luaF_newLclosure(L, %d);", nup);
+    println("      ncl->p = p;");
+    println("      setclLvalue2s(L, ra, ncl);  /* anchor new closure in stack */");
+    for (int j = 0; j < nup; j++) {
+        if (p->upvalues[j].instack) {
+            println("      ncl->upvals[%d] = luaF_findupval(L, base + %d);", j, p->upvalues[j].idx);
+        } else {
+            println("      ncl->upvals[%d] = cl->upvals[%d];", j, p->upvalues[j].idx);
+        }
+        println("      luaC_objbarrier(L, ncl, ncl->upvals[%d]);", j);
+    }
+    if (cacheable) {
+        println("      p->cache = ncl;  /* save it for reuse */");
+        println("      luaC_objbarrier(L, p, ncl);");
+    }
+    println("    }");
+}
+
 static
 void create_function(Proto *f)
 {
@@ -39,6 +89,9 @@ void create_function(Proto *f)
         println("// lines: %d - %d", f->linedefined, f->lastlinedefined);
     }
 
+    int *guard_of = print_guards(f, func_id);
+    char *targets = find_jump_targets(f);
+
     println("static");
     println("CallInfo *magic_implementation_%02d(lua_State *L, CallInfo *ci)", func_id);
     println("{");
@@ -105,6 +158,14 @@ void create_function(Proto *f)
         println("  label_%02d: {", pc);
         println("    aot_vmfetch(0x%08x);", instr);
 
+        if (guard_of[pc] >= 0) {
+            char next_label[32];
+            sprintf(next_label, "goto label_%02d;", pc + 1);
+            println_speculation(f, func_id, pc, guard_of[pc], "    ", next_label);
+            println("  }");
+            println("  generic_%02d: {", pc);
+        }
+
         switch (op) {
             case OP_MOVE: {
                 println("    setobjs2s(L, ra, RB(i));");
@@ -169,6 +230,9 @@ void create_function(Proto *f)
                 println("    TValue *rc = KC(i);");
                 println("    TString *key = tsvalue(rc);  /* key must be a string */");
                 println("    if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {");
+                if (guard_of[pc] >= 0) {
+                    println("      aot_slotupdate(luaot_slot_%02d_%02d, upval, slot);", func_id, pc);
+                }
                 println("      setobj2s(L, ra, slot);");
                 println("    }");
                 println("    else");
@@ -209,6 +273,9 @@ void create_function(Proto *f)
                 println("    TValue *rc = KC(i);");
                 println("    TString *key = tsvalue(rc);  /* key must be a string */");
                 println("    if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {");
+                if (guard_of[pc] >= 0) {
+                    println("      aot_slotupdate(luaot_slot_%02d_%02d, rb, slot);", func_id, pc);
+                }
                 println("      setobj2s(L, ra, slot);");
                 println("    }");
                 println("    else");
@@ -294,6 +361,9 @@ void create_function(Proto *f)
                 println("    TString *key = tsvalue(rc);  /* key must be a string */");
                 println("    setobj2s(L, ra + 1, rb);");
                 println("    if (luaV_fastget(L, rb, key, slot, luaH_getstr)) {");
+                if (guard_of[pc] >= 0) {
+                    println("      aot_slotupdate(luaot_slot_%02d_%02d, rb, slot);", func_id, pc);
+                }
                 println("      setobj2s(L, ra, slot);");
                 println("    }");
                 println("    else");
@@ -476,9 +546,13 @@ void create_function(Proto *f)
                 break;
             }
             case OP_CONCAT: {
-                println("    int n = GETARG_B(i);  /* number of elements to concatenate */");
-                println("    L->top = ra + n;  /* mark the end of concat operands */");
-                println("    ProtectNT(luaV_concat(L, n));");
+                // The single-pass luaV_concatn returns 0 when a metamethod
+                // is needed.
+                int n = GETARG_B(instr);
+                println("    L->top = ra + %d;  /* mark the end of concat operands */", n);
+                println("    savepc(L);  /* in case of errors */");
+                println("    if (l_unlikely(!luaV_concatn(L, ra, %d)))", n);
+                println("      ProtectNT(luaV_concat(L, %d));", n);
                 println("    checkGC(L, L->top); /* 'luaV_concat' ensures correct top */");
                 break;
             }
@@ -562,14 +636,61 @@ void create_function(Proto *f)
                 break;
             }
             case OP_CALL: {
+                int b = GETARG_B(instr);
+                int nresults = GETARG_C(instr) - 1;
+                if (b == 0) {
+                    // Variable number of arguments (previous instruction set top)
+                    println("    CallInfo *newci;");
+                    println("    savepc(L);  /* in case of errors */");
+                    println("    if (ttisleaf(s2v(ra)) && l_likely(!L->hookmask)) {");
+                    println("        luaD_callleaf(L, ra, %d);  /* leaf C function */", nresults);
+                    println("        updatetrap(ci);");
+                    println("    }");
+                    println("    else if ((newci = luaD_precall(L, ra, %d)) == NULL)", nresults);
+                    println("        updatetrap(ci);  /* C call; nothing else to be done */");
+                    println("    else {");
+                    println("        ci = newci;");
+                    println("        ci->callstatus = 0;  /* call re-uses 'luaV_execute' */");
+                    println("        return ci;");
+                    println("    }");
+                    break;
+                }
+                // The number of arguments and results is known statically, so
+                // we can inline the Lua-function case of luaD_precall. Leaf C
+                // functions go through luaD_callleaf; other C functions and
+                // __call metamethods still go through the generic luaD_precall.
                 println("    CallInfo *newci;");
-                println("    int b = GETARG_B(i);");
-                println("    int nresults = GETARG_C(i) - 1;");
-                println("    if (b != 0)  /* fixed number of arguments? */");
-                println("        L->top = ra + b;  /* top signals number of arguments */");
-                println("    /* else previous instruction set top */");
+                println("    L->top = ra + %d;  /* top signals number of arguments */", b);
                 println("    savepc(L);  /* in case of errors */");
-                println("    if ((newci = luaD_precall(L, ra, nresults)) == NULL)");
+                if (is_table_call(f, targets, pc)) {
+                    println("    if (l_likely(!L->hookmask) && luaH_tablecall(L, ra, %d, %d)) {", b - 1, nresults);
+                    println("        checkGC(L, ra + 1);  /* table.new or table.clear */");
+                    println("    }");
+                    print("    else ");
+                } else {
+                    print("    ");
+                }
+                println("if (l_likely(ttisLclosure(s2v(ra)))) {  /* Lua function? */");
+                println("        Proto *p = clLvalue(s2v(ra))->p;");
+                println("        int fsize = p->maxstacksize;  /* frame size */");
+                println("        int narg = %d;  /* number of real arguments */", b - 1);
+                println("        checkstackGCp(L, fsize, ra);");
+                println("        newci = L->ci->next ? L->ci->next : luaE_extendCI(L);");
+                println("        newci->nresults = %d;", nresults);
+                println("        newci->u.l.savedpc = p->code;  /* starting point */");
+                println("        newci->top = ra + 1 + fsize;");
+                println("        newci->func = ra;");
+                println("        newci->callstatus = 0;  /* call re-uses 'luaV_execute' */");
+                println("        L->ci = newci;");
+                println("        for (; narg < p->numparams; narg++)");
+                println("            setnilvalue(s2v(L->top++));  /* complete missing arguments */");
+                println("        return newci;");
+                println("    }");
+                println("    else if (ttisleaf(s2v(ra)) && l_likely(!L->hookmask)) {");
+                println("        luaD_callleaf(L, ra, %d);  /* leaf C function */", nresults);
+                println("        updatetrap(ci);");
+                println("    }");
+                println("    else if ((newci = luaD_precall(L, ra, %d)) == NULL)", nresults);
                 println("        updatetrap(ci);  /* C call; nothing else to be done */");
                 println("    else {");
                 println("        ci = newci;");
@@ -582,7 +703,7 @@ void create_function(Proto *f)
                 println("    int b = GETARG_B(i);  /* number of arguments + 1 (function) */");
                 println("    int nparams1 = GETARG_C(i);");
                 println("    /* delta is virtual 'func' - real 'func' (vararg functions) */");
-                println("    int delta = (nparams1) ? ci->u.l.nextraargs + nparams1 : 0;");
+                println("    int delta = (nparams1) ? ci->u.l.delta : 0;");
                 println("    if (b != 0)");
                 println("      L->top = ra + b;");
                 println("    else  /* previous instruction set top */");
@@ -613,6 +734,32 @@ void create_function(Proto *f)
                 break;
             }
             case OP_RETURN: {
+                int n = GETARG_B(instr) - 1;
+                if (n >= 0 && !TESTARG_k(instr) && GETARG_C(instr) == 0) {
+                    // Fixed number of results, no upvalues to close and not
+                    // a vararg function: do the 'poscall' here, like in
+                    // OP_RETURN1, moving the results straight to 'func'.
+                    println("    if (l_unlikely(L->hookmask)) {");
+                    println("      L->top = ra + %d;", n);
+                    println("      savepc(ci);");
+                    println("      luaD_poscall(L, ci, %d);  /* no hurry... */", n);
+                    println("      trap = 1;");
+                    println("    }");
+                    println("    else {  /* do the 'poscall' here */");
+                    println("      int nres = ci->nresults;");
+                    println("      int j;");
+                    println("      L->ci = ci->previous;  /* back to caller */");
+                    println("      if (nres < 0)  /* LUA_MULTRET? */");
+                    println("        nres = %d;", n);
+                    println("      for (j = 0; j < %d && j < nres; j++)", n);
+                    println("        setobjs2s(L, base - 1 + j, ra + j);");
+                    println("      for (; l_unlikely(j < nres); j++)");
+                    println("        setnilvalue(s2v(base - 1 + j));");
+                    println("      L->top = base - 1 + nres;");
+                    println("    }");
+                    println_goto_ret();
+                    break;
+                }
                 println("    int n = GETARG_B(i) - 1;  /* number of results */");
                 println("    int nparams1 = GETARG_C(i);");
                 println("    if (n < 0)  /* not fixed? */");
@@ -626,7 +773,7 @@ void create_function(Proto *f)
                 println("      updatestack(ci);");
                 println("    }");
                 println("    if (nparams1)  /* vararg function? */");
-                println("      ci->func -= ci->u.l.nextraargs + nparams1;");
+                println("      ci->func -= ci->u.l.delta;");
                 println("    L->top = ra + n;  /* set call for 'luaD_poscall' */");
                 println("    luaD_poscall(L, ci, n);");
                 println("    updatetrap(ci);  /* 'luaD_poscall' can change hooks */");
@@ -708,11 +855,13 @@ void create_function(Proto *f)
                 println("       to-be-closed variable. The call will use the stack after");
                 println("       these values (starting at 'ra + 4')");
                 println("    */");
-                println("    /* push function, state, and control variable */");
-                println("    memcpy(ra + 4, ra, 3 * sizeof(*ra));");
-                println("    L->top = ra + 4 + 3;");
-                println("    ProtectNT(luaD_call(L, ra + 4, GETARG_C(i)));  /* do the call */");
-                println("    updatestack(ci);  /* stack may have changed */");
+                println("    if (l_unlikely(L->hookmask) || !luaH_tfornext(L, ra, %d)) {", GETARG_C(instr));
+                println("      /* push function, state, and control variable */");
+                println("      memcpy(ra + 4, ra, 3 * sizeof(*ra));");
+                println("      L->top = ra + 4 + 3;");
+                println("      ProtectNT(luaD_call(L, ra + 4, GETARG_C(i)));  /* do the call */");
+                println("      updatestack(ci);  /* stack may have changed */");
+                println("    }");
                 // (!) Going to the next instruction is a no-op
                 break;
             }
@@ -745,7 +894,7 @@ void create_function(Proto *f)
                 println("          luaH_resizearray(L, h, last);  /* preallocate it at once */");
                 println("        for (; n > 0; n--) {");
                 println("          TValue *val = s2v(ra + n);");
-                println("          setobj2t(L, &h->array[last - 1], val);");
+                println("          setarrayvalue(L, h, last - 1, val);");
                 println("          last--;");
                 println("          luaC_barrierback(L, obj2gco(h), val);");
                 println("        }");
@@ -755,13 +904,20 @@ void create_function(Proto *f)
                 break;
             }
             case OP_CLOSURE: {
-                println("    Proto *p = cl->p->p[GETARG_Bx(i)];");
-                println("    halfProtect(pushclosure(L, p, cl->upvals, base, ra));");
+                println_closure(f, GETARG_Bx(instr));
                 println("    checkGC(L, ra + 1);");
                 break;
             }
             case OP_VARARG: {
                 println("    int n = GETARG_C(i) - 1;  /* required results */");
+                if (is_select_vararg(f, pc)) {
+                    println("    if (l_likely(!L->hookmask)) {");
+                    println("      int done;");
+                    println("      Protect(done = luaT_selectvarargs(L, ci, ra - 2, %d));", select_nresults(f, pc));
+                    println("      if (done)  /* did the whole 'select(x, ...)'? */");
+                    println("        goto LUAOT_SKIP1;");
+                    println("    }");
+                }
                 println("    Protect(luaT_getvarargs(L, ci, ra, n));");
                 break;
             }
@@ -791,4 +947,7 @@ void create_function(Proto *f)
 
     println("}");
     printnl();
+
+    free(guard_of);
+    free(targets);
 }
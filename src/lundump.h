@@ -24,7 +24,11 @@
 #define MYINT(s)	(s[0]-'0')  /* assume one-digit numerals */
 #define LUAC_VERSION	(MYINT(LUA_VERSION_MAJOR)*16+MYINT(LUA_VERSION_MINOR))
 
-#define LUAC_FORMAT	0	/* this is the official format */
+/*
+** The official format is 0. This one has the superinstructions of
+** 'lopcodes.h', which other builds of Lua 5.4 do not know.
+*/
+#define LUAC_FORMAT	1
 
 /* load one chunk; from lundump.c */
 LUAI_FUNC LClosure* luaU_undump (lua_State* L, ZIO* Z, const char* name);
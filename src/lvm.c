@@ -587,7 +587,9 @@ int luaV_lessequal (lua_State *L, const TValue *l, const TValue *r) {
 int luaV_equalobj (lua_State *L, const TValue *t1, const TValue *t2) {
   const TValue *tm;
   if (ttypetag(t1) != ttypetag(t2)) {  /* not the same variant? */
-    if (ttype(t1) != ttype(t2) || ttype(t1) != LUA_TNUMBER)
+    if (ttislightcf(t1) && ttislightcf(t2))  /* leaf and plain? */
+      return fvalue(t1) == fvalue(t2);
+    else if (ttype(t1) != ttype(t2) || ttype(t1) != LUA_TNUMBER)
       return 0;  /* only numbers can be equal with different variants */
     else {  /* two numbers with different variants */
       /* One of them is an integer. If the other does not have an
@@ -605,7 +607,7 @@ int luaV_equalobj (lua_State *L, const TValue *t1, const TValue *t2) {
     case LUA_VNUMINT: return (ivalue(t1) == ivalue(t2));
     case LUA_VNUMFLT: return luai_numeq(fltvalue(t1), fltvalue(t2));
     case LUA_VLIGHTUSERDATA: return pvalue(t1) == pvalue(t2);
-    case LUA_VLCF: return fvalue(t1) == fvalue(t2);
+    case LUA_VLCF: case LUA_VLEAF: return fvalue(t1) == fvalue(t2);
     case LUA_VSHRSTR: return eqshrstr(tsvalue(t1), tsvalue(t2));
     case LUA_VLNGSTR: return luaS_eqlngstr(tsvalue(t1), tsvalue(t2));
     case LUA_VUSERDATA: {
@@ -702,6 +704,102 @@ void luaV_concat (lua_State *L, int total) {
 #endif
 
 
+#ifndef LUAOT_IS_MODULE
+/* number of decimal digits of an unsigned integer */
+static int udigits (lua_Unsigned u) {
+  int n = 1;
+  while (u >= 10) {
+    u /= 10;
+    n++;
+  }
+  return n;
+}
+
+
+/* length of the decimal representation of integer 'i' */
+static int intlen (lua_Integer i) {
+  return (i < 0) ? 1 + udigits(0u - l_castS2U(i)) : udigits(l_castS2U(i));
+}
+
+
+/* write integer 'i', whose representation has 'len' chars, to 'buff' */
+static void int2buff (char *buff, lua_Integer i, int len) {
+  lua_Unsigned u = (i < 0) ? 0u - l_castS2U(i) : l_castS2U(i);
+  char *p = buff + len;
+  do {
+    *--p = cast_char('0' + cast_int(u % 10));
+    u /= 10;
+  } while (u != 0);
+  if (i < 0)
+    *--p = '-';
+}
+#endif
+
+
+/*
+** Single-pass concatenation used by AOT code, which knows statically
+** the number 'total' of operands (from 'ra' up to 'ra + total - 1').
+** Integers are formatted directly into the result. Returns 0, without
+** changing the stack, if some operand is neither a string nor a number
+** (so that the caller can use 'luaV_concat' to call the metamethod).
+** All operands are measured here, even those that the compiler saw
+** loaded from string constants, as a hook may have changed them.
+*/
+#ifndef LUAOT_IS_MODULE
+int luaV_concatn (lua_State *L, StkId ra, int total) {
+  size_t tl = 0;
+  int j;
+  TString *ts;
+  char *buff;
+  char sbuff[LUAI_MAXSHORTLEN];
+  for (j = 0; j < total; j++) {  /* check types before converting anything */
+    TValue *o = s2v(ra + j);
+    if (!(ttisstring(o) || cvt2str(o)))
+      return 0;
+  }
+  for (j = 0; j < total; j++) {  /* collect total length */
+    TValue *o = s2v(ra + j);
+    size_t l;
+    if (ttisinteger(o))
+      l = intlen(ivalue(o));
+    else {
+      cast_void(tostring(L, o));
+      l = vslen(o);
+    }
+    if (l_unlikely(l >= (MAX_SIZE/sizeof(char)) - tl))
+      luaG_runerror(L, "string length overflow");
+    tl += l;
+  }
+  if (tl <= LUAI_MAXSHORTLEN) {
+    ts = NULL;
+    buff = sbuff;
+  }
+  else {  /* long string; copy operands directly to final result */
+    ts = luaS_createlngstrobj(L, tl);
+    buff = getstr(ts);
+  }
+  for (j = 0; j < total; j++) {  /* copy operands */
+    TValue *o = s2v(ra + j);
+    if (ttisinteger(o)) {
+      int l = intlen(ivalue(o));
+      int2buff(buff, ivalue(o), l);
+      buff += l;
+    }
+    else {
+      size_t l = vslen(o);
+      memcpy(buff, svalue(o), l * sizeof(char));
+      buff += l;
+    }
+  }
+  if (ts == NULL)
+    ts = luaS_newlstr(L, sbuff, tl);
+  setsvalue2s(L, ra, ts);
+  L->top = ra + 1;
+  return 1;
+}
+#endif
+
+
 /*
 ** Main operation 'ra = #rb'.
 */
@@ -713,7 +811,7 @@ void luaV_objlen (lua_State *L, StkId ra, const TValue *rb) {
       Table *h = hvalue(rb);
       tm = fasttm(L, h->metatable, TM_LEN);
       if (tm) break;  /* metamethod? break switch to call it */
-      setivalue(s2v(ra), luaH_getn(h));  /* else primitive len */
+      setivalue(s2v(ra), luaH_getn(L, h));  /* else primitive len */
       return;
     }
     case LUA_VSHRSTR: {
@@ -845,7 +943,7 @@ void luaV_finishOp (lua_State *L) {
   CallInfo *ci = L->ci;
   StkId base = ci->func + 1;
   Instruction inst = *(ci->u.l.savedpc - 1);  /* interrupted instruction */
-  OpCode op = GET_OPCODE(inst);
+  OpCode op = unfusedop(GET_OPCODE(inst));
   switch (op) {  /* finish its execution */
     case OP_MMBIN: case OP_MMBINI: case OP_MMBINK: {
       setobjs2s(L, base + GETARG_A(*(ci->u.l.savedpc - 2)), --L->top);
@@ -1061,6 +1159,132 @@ void luaV_finishOp (lua_State *L) {
         }  \
         docondjump(); }
 
+
+/*
+** Inline caches of field accesses with a constant string key. A cache
+** remembers the position in the node array where its instruction last
+** found the key, and it is trusted only if that position is inside the
+** node array of the current table and holds that very key. (Keys are
+** unique in a table, so that is the right slot whatever table it is.)
+** So caches need no invalidation when 'luaH_resize' replaces a node
+** array or a key is removed; they just miss once. Checking the key is
+** as cheap as checking the node array, so there is no point in keeping
+** the latter too.
+*/
+#define icache()	(cl->p->icache + pcRel(pc, cl->p))
+
+#define cachednodeget(c,h,key,slot) \
+  ((c)->idx < cast_uint(sizenode(h)) && \
+   keyisshrstr(gnode(h, (c)->idx)) && \
+   keystrval(gnode(h, (c)->idx)) == (key) && \
+   (slot = gval(gnode(h, (c)->idx)), !isempty(slot)))
+
+#if defined(LUAI_SHAPES)
+
+/*
+** A table with a shape has its keys in the shape, not in the node array,
+** so the cache keeps the slot of the key instead. That slot is checked
+** the same way, by comparing the key of the shape at that slot.
+*/
+#define cachedget(c,t,key,slot) \
+  (ttistable(t) && \
+   (hvalue(t)->shape != NULL \
+    ? ((c)->idx < hvalue(t)->shape->nkeys && \
+       hvalue(t)->shape->keys[(c)->idx] == (key) && \
+       (slot = &hvalue(t)->slots[(c)->idx], !isempty(slot))) \
+    : cachednodeget(c, hvalue(t), key, slot)))
+
+#define cacheupdate(c,t,slot) \
+  ((c)->idx = (hvalue(t)->shape != NULL) \
+              ? cast_uint(slot - hvalue(t)->slots) \
+              : cast_uint(cast(const Node *, slot) - hvalue(t)->node))
+
+#else
+
+#define cachedget(c,t,key,slot) \
+  (ttistable(t) && cachednodeget(c, hvalue(t), key, slot))
+
+/* remember where 'luaV_fastget' found 'slot' (before 'ra' may overwrite 't') */
+#define cacheupdate(c,t,slot) \
+  ((c)->idx = cast_uint(cast(const Node *, slot) - hvalue(t)->node))
+
+#endif
+
+#if defined(LUAI_CACHESTATS)
+#define cachehit(c)	((c)->hits++)
+#else
+#define cachehit(c)	((void)0)
+#endif
+
+
+/*
+** Field get with the inline cache; 'f' is the raw get function to use
+** on a miss.
+*/
+#define cachedfinishget(L,t,key,kv,f) {  \
+  const TValue *slot;  \
+  InlineCache *c = icache();  \
+  if (cachedget(c, t, key, slot)) {  \
+    cachehit(c);  \
+    setobj2s(L, ra, slot);  \
+  }  \
+  else {  \
+    c->misses++;  \
+    if (luaV_fastget(L, t, key, slot, f)) {  \
+      cacheupdate(c, t, slot);  \
+      setobj2s(L, ra, slot);  \
+    }  \
+    else  \
+      Protect(luaV_finishget(L, t, kv, ra, slot));  \
+  } }
+
+
+/* Field set with the inline cache; 'rb' is the key and 'rc' the value */
+#define cachedfinishset(L,t,key,rb,rc) {  \
+  const TValue *slot;  \
+  InlineCache *c = icache();  \
+  if (cachedget(c, t, key, slot)) {  \
+    cachehit(c);  \
+    luaV_finishfastset(L, t, slot, rc);  \
+  }  \
+  else {  \
+    c->misses++;  \
+    if (luaV_fastget(L, t, key, slot, luaH_getshortstr)) {  \
+      cacheupdate(c, t, slot);  \
+      luaV_finishfastset(L, t, slot, rc);  \
+    }  \
+    else  \
+      Protect(luaV_finishset(L, t, rb, rc, slot));  \
+  } }
+
+
+/*
+** Is OP_VARARG 'i', getting all varargs, the last argument of call 'c'
+** (the next instruction) with a single argument before it, as in
+** 'select(x, ...)'? (See 'luaT_selectvarargs'.) A tail call is done as
+** a call with all results, which the OP_RETURN after it returns.
+*/
+#define isselectcall(i,c)  \
+  ((GET_OPCODE(c) == OP_CALL || GET_OPCODE(c) == OP_TAILCALL) &&  \
+   GETARG_B(c) == 0 && GETARG_A(c) + 2 == GETARG_A(i))
+
+#define selectnresults(c)  \
+  (GET_OPCODE(c) == OP_CALL ? GETARG_C(c) - 1 : LUA_MULTRET)
+
+
+#define op_getfield(L) {  \
+  TValue *rb = vRB(i);  \
+  TValue *rc = KC(i);  \
+  TString *key = tsvalue(rc);  /* key must be a string */  \
+  cachedfinishget(L, rb, key, rc, luaH_getshortstr); }
+
+
+#define op_setfield(L) {  \
+  TValue *rb = KB(i);  \
+  TValue *rc = RKC(i);  \
+  TString *key = tsvalue(rb);  /* key must be a string */  \
+  cachedfinishset(L, s2v(ra), key, rb, rc); }
+
 /* }================================================================== */
 
 
@@ -1149,12 +1373,27 @@ void luaV_finishOp (lua_State *L) {
 
 
 /* fetch an instruction and prepare its execution */
+#if defined(LUAI_OPCOUNT)
+/* count the execution of instruction 'i', just fetched from 'pc - 1' */
+#define countop(i)	{ \
+  OpStats *os = &G(L)->opstats; \
+  OpCode op_ = GET_OPCODE(i); \
+  os->ops[op_]++; \
+  os->pairs[os->last][op_]++; \
+  os->last = op_; \
+  cl->p->opcounts[pcRel(pc, cl->p)]++; \
+}
+#else
+#define countop(i)	((void)0)
+#endif
+
 #define vmfetch()	{ \
   if (l_unlikely(trap)) {  /* stack reallocation or hooks? */ \
     trap = luaG_traceexec(L, pc);  /* handle hooks */ \
     updatebase(ci);  /* correct stack */ \
   } \
   i = *(pc++); \
+  countop(i); \
   ra = RA(i); /* WARNING: any stack reallocation invalidates 'ra' */ \
 }
 
@@ -1162,6 +1401,17 @@ void luaV_finishOp (lua_State *L) {
 #define vmcase(l)	case l:
 #define vmbreak		break
 
+/*
+** A superinstruction ends with 'vmfuse', which goes straight to the code
+** of its second instruction (marked by 'vmfused'), without dispatching
+** it. With hooks, the second instruction is dispatched as usual.
+*/
+#define vmfused(l)	fused_##l:
+#define vmfuse(l)	{ if (l_likely(!trap)) {  \
+                            i = *(pc++); countop(i);  \
+                            ra = RA(i); goto fused_##l; }  \
+                          vmbreak; }
+
 static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
 {
   LClosure *cl;
@@ -1181,6 +1431,8 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
       return ci;
   }
 #endif
+  if (l_unlikely(cl->p->icache == NULL))
+    luaF_initcache(L, cl->p);  /* first interpreted call */
   k = cl->p->k;
   pc = ci->u.l.savedpc;
   if (l_unlikely(trap)) {
@@ -1205,7 +1457,8 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
     /* invalidate top for instructions not expecting it */
     lua_assert(isIT(i) || (cast_void(L->top = base), 1));
     vmdispatch (GET_OPCODE(i)) {
-      vmcase(OP_MOVE) {
+      vmcase(OP_MOVE)
+      vmfused(OP_MOVE) {
         setobjs2s(L, ra, RB(i));
         vmbreak;
       }
@@ -1262,15 +1515,10 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         vmbreak;
       }
       vmcase(OP_GETTABUP) {
-        const TValue *slot;
         TValue *upval = cl->upvals[GETARG_B(i)]->v;
         TValue *rc = KC(i);
         TString *key = tsvalue(rc);  /* key must be a string */
-        if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, upval, rc, ra, slot));
+        cachedfinishget(L, upval, key, rc, luaH_getshortstr);
         vmbreak;
       }
       vmcase(OP_GETTABLE) {
@@ -1301,29 +1549,17 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         }
         vmbreak;
       }
-      vmcase(OP_GETFIELD) {
-        const TValue *slot;
-        TValue *rb = vRB(i);
-        TValue *rc = KC(i);
-        TString *key = tsvalue(rc);  /* key must be a string */
-        if (luaV_fastget(L, rb, key, slot, luaH_getshortstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, rb, rc, ra, slot));
+      vmcase(OP_GETFIELD)
+      vmfused(OP_GETFIELD) {
+        op_getfield(L);
         vmbreak;
       }
       vmcase(OP_SETTABUP) {
-        const TValue *slot;
         TValue *upval = cl->upvals[GETARG_A(i)]->v;
         TValue *rb = KB(i);
         TValue *rc = RKC(i);
         TString *key = tsvalue(rb);  /* key must be a string */
-        if (luaV_fastget(L, upval, key, slot, luaH_getshortstr)) {
-          luaV_finishfastset(L, upval, slot, rc);
-        }
-        else
-          Protect(luaV_finishset(L, upval, rb, rc, slot));
+        cachedfinishset(L, upval, key, rb, rc);
         vmbreak;
       }
       vmcase(OP_SETTABLE) {
@@ -1355,15 +1591,7 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         vmbreak;
       }
       vmcase(OP_SETFIELD) {
-        const TValue *slot;
-        TValue *rb = KB(i);
-        TValue *rc = RKC(i);
-        TString *key = tsvalue(rb);  /* key must be a string */
-        if (luaV_fastget(L, s2v(ra), key, slot, luaH_getshortstr)) {
-          luaV_finishfastset(L, s2v(ra), slot, rc);
-        }
-        else
-          Protect(luaV_finishset(L, s2v(ra), rb, rc, slot));
+        op_setfield(L);
         vmbreak;
       }
       vmcase(OP_NEWTABLE) {
@@ -1385,16 +1613,12 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         vmbreak;
       }
       vmcase(OP_SELF) {
-        const TValue *slot;
         TValue *rb = vRB(i);
         TValue *rc = RKC(i);
         TString *key = tsvalue(rc);  /* key must be a string */
         setobj2s(L, ra + 1, rb);
-        if (luaV_fastget(L, rb, key, slot, luaH_getstr)) {
-          setobj2s(L, ra, slot);
-        }
-        else
-          Protect(luaV_finishget(L, rb, rc, ra, slot));
+        /* a long-string key never hits, as the cache only holds short ones */
+        cachedfinishget(L, rb, key, rc, luaH_getstr);
         vmbreak;
       }
       vmcase(OP_ADDI) {
@@ -1655,7 +1879,8 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         }
         vmbreak;
       }
-      vmcase(OP_CALL) {
+      vmcase(OP_CALL)
+      vmfused(OP_CALL) {
         CallInfo *newci;
         int b = GETARG_B(i);
         int nresults = GETARG_C(i) - 1;
@@ -1663,7 +1888,11 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
           L->top = ra + b;  /* top signals number of arguments */
         /* else previous instruction set top */
         savepc(L);  /* in case of errors */
-        if ((newci = luaD_precall(L, ra, nresults)) == NULL)
+        if (ttisleaf(s2v(ra)) && l_likely(!L->hookmask)) {
+          luaD_callleaf(L, ra, nresults);  /* leaf C function */
+          updatetrap(ci);
+        }
+        else if ((newci = luaD_precall(L, ra, nresults)) == NULL)
           updatetrap(ci);  /* C call; nothing else to be done */
         else {  /* Lua call: run function in this same C frame */
           ci = newci;
@@ -1676,7 +1905,7 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         int b = GETARG_B(i);  /* number of arguments + 1 (function) */
         int nparams1 = GETARG_C(i);
         /* delta is virtual 'func' - real 'func' (vararg functions) */
-        int delta = (nparams1) ? ci->u.l.nextraargs + nparams1 : 0;
+        int delta = (nparams1) ? ci->u.l.delta : 0;
         if (b != 0)
           L->top = ra + b;
         else  /* previous instruction set top */
@@ -1719,7 +1948,7 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
           updatestack(ci);
         }
         if (nparams1)  /* vararg function? */
-          ci->func -= ci->u.l.nextraargs + nparams1;
+          ci->func -= ci->u.l.delta;
         L->top = ra + n;  /* set call for 'luaD_poscall' */
         luaD_poscall(L, ci, n);
         updatetrap(ci);  /* 'luaD_poscall' can change hooks */
@@ -1805,13 +2034,16 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         /* 'ra' has the iterator function, 'ra + 1' has the state,
            'ra + 2' has the control variable, and 'ra + 3' has the
            to-be-closed variable. The call will use the stack after
-           these values (starting at 'ra + 4')
+           these values (starting at 'ra + 4'). A traversal with 'next'
+           needs no call (see 'luaH_tfornext').
         */
-        /* push function, state, and control variable */
-        memcpy(ra + 4, ra, 3 * sizeof(*ra));
-        L->top = ra + 4 + 3;
-        ProtectNT(luaD_call(L, ra + 4, GETARG_C(i)));  /* do the call */
-        updatestack(ci);  /* stack may have changed */
+        if (l_unlikely(L->hookmask) || !luaH_tfornext(L, ra, GETARG_C(i))) {
+          /* push function, state, and control variable */
+          memcpy(ra + 4, ra, 3 * sizeof(*ra));
+          L->top = ra + 4 + 3;
+          ProtectNT(luaD_call(L, ra + 4, GETARG_C(i)));  /* do the call */
+          updatestack(ci);  /* stack may have changed */
+        }
         i = *(pc++);  /* go to next instruction */
         lua_assert(GET_OPCODE(i) == OP_TFORLOOP && ra == RA(i));
         goto l_tforloop;
@@ -1841,7 +2073,7 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
           luaH_resizearray(L, h, last);  /* preallocate it at once */
         for (; n > 0; n--) {
           TValue *val = s2v(ra + n);
-          setobj2t(L, &h->array[last - 1], val);
+          setarrayvalue(L, h, last - 1, val);
           last--;
           luaC_barrierback(L, obj2gco(h), val);
         }
@@ -1855,6 +2087,15 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
       }
       vmcase(OP_VARARG) {
         int n = GETARG_C(i) - 1;  /* required results */
+        if (n < 0 && isselectcall(i, *pc) && l_likely(!L->hookmask)) {
+          int done;
+          Protect(done = luaT_selectvarargs(L, ci, ra - 2,
+                                            selectnresults(*pc)));
+          if (done) {  /* did the whole 'select(x, ...)'? */
+            pc++;  /* skip the call */
+            vmbreak;
+          }
+        }
         Protect(luaT_getvarargs(L, ci, ra, n));
         vmbreak;
       }
@@ -1871,6 +2112,22 @@ static CallInfo *luaV_execute_(lua_State *L, CallInfo *ci)
         lua_assert(0);
         vmbreak;
       }
+      vmcase(OP_MOVECALL) {
+        setobjs2s(L, ra, RB(i));
+        vmfuse(OP_CALL);
+      }
+      vmcase(OP_GETUPVALMOVE) {
+        setobj2s(L, ra, cl->upvals[GETARG_B(i)]->v);
+        vmfuse(OP_MOVE);
+      }
+      vmcase(OP_GETFIELD2) {
+        op_getfield(L);
+        vmfuse(OP_GETFIELD);
+      }
+      vmcase(OP_SETFIELDGET) {
+        op_setfield(L);
+        vmfuse(OP_GETFIELD);
+      }
     }
   }
 }
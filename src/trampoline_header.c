@@ -22,3 +22,60 @@
 #undef  vmdispatch
 #undef  vmcase
 #undef  vmbreak
+
+//
+// Speculation support. Each speculative instruction has a guard, whose
+// failures are counted, and a slot cache that remembers the node where the
+// key was found the last time.
+//
+
+typedef struct AotGuardList {
+  AotGuard *guards;
+  int size;
+} AotGuardList;
+
+typedef struct AotSlotCache {
+  Node *node;  /* node array of the table where the key was found */
+  unsigned int idx;  /* position of the key in that array */
+} AotSlotCache;
+
+/* Is 'tv' a table whose cached node still holds short string 'key'? */
+#define aot_nodecheck(c,h,key,slot) \
+  ((h)->node == (c).node && \
+   (c).idx < sizenode(h) && \
+   keyisshrstr(gnode(h, (c).idx)) && \
+   keystrval(gnode(h, (c).idx)) == (key) && \
+   (slot = gval(gnode(h, (c).idx)), !isempty(slot)))
+
+#if defined(LUAI_SHAPES)
+
+/* for a table with a shape, 'idx' is a slot, checked by the shape's key */
+#define aot_slotcheck(c,tv,key,slot) \
+  (ttistable(tv) && \
+   (hvalue(tv)->shape != NULL \
+    ? ((c).idx < hvalue(tv)->shape->nkeys && \
+       hvalue(tv)->shape->keys[(c).idx] == (key) && \
+       (slot = &hvalue(tv)->slots[(c).idx], !isempty(slot))) \
+    : aot_nodecheck(c, hvalue(tv), key, slot)))
+
+#define aot_slotupdate(c,tv,slot) \
+  ((c).node = hvalue(tv)->node, \
+   (c).idx = (hvalue(tv)->shape != NULL) \
+             ? cast_uint(slot - hvalue(tv)->slots) \
+             : cast_uint(cast(const Node *, slot) - (c).node))
+
+#else
+
+#define aot_slotcheck(c,tv,key,slot) \
+  (ttistable(tv) && aot_nodecheck(c, hvalue(tv), key, slot))
+
+/* remember where 'luaV_fastget' found 'slot' (before 'ra' may overwrite 'tv') */
+#define aot_slotupdate(c,tv,slot) \
+  ((c).node = hvalue(tv)->node, \
+   (c).idx = cast_uint(cast(const Node *, slot) - (c).node))
+
+#endif
+
+/* saturating, so that the counter never makes a bad site look good */
+#define aot_guardfailed(g) \
+  { if (l_likely((g).failures < UINT_MAX)) (g).failures++; }